@@ -20,6 +20,7 @@
 #include <termctrl.h>
 #include "product.h"
 #include "calculatecrc.h"
+#include <crc32.h>
 #include <cpu.h>
 #include <libelf.h>
 #include <string.h>
@@ -110,34 +111,23 @@ io_getchar(char *ch)
 
 void copy_from_flash(uint64_t cnt, uint64_t src, uint64_t dest);
 
-const uint32_t CrcTableHigh[16] = {
-	0x00000000, 0x4C11DB70, 0x9823B6E0, 0xD4326D90,
-	0x34867077, 0x7897AB07, 0xACA5C697, 0xE0B41DE7,
-	0x690CE0EE, 0x251D3B9E, 0xF12F560E, 0xBD3E8D7E,
-	0x5D8A9099, 0x119B4BE9, 0xC5A92679, 0x89B8FD09
-};
-const uint32_t CrcTableLow[16] = {
-	0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
-	0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
-	0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
-	0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
-};
-
 static unsigned long
 check_flash_image(unsigned long rombase, unsigned long length,
 		  unsigned long start_crc)
 {
-
 	uint32_t AccumCRC = start_crc;
-	char val;
-	uint32_t Temp;
-	while (length-- > 0) {
-		val = load8_ci(rombase++);
-		Temp = ((AccumCRC >> 24) ^ val) & 0x000000ff;
-		AccumCRC <<= 8;
-		AccumCRC ^= CrcTableHigh[Temp / 16];
-		AccumCRC ^= CrcTableLow[Temp % 16];
+
+	crc32_init();
+
+	/* the flash is slow, so read it 8 bytes at a time */
+	while (length > 0 && (rombase & 7)) {
+		AccumCRC = crc32_update8(AccumCRC, load8_ci(rombase++));
+		length--;
 	}
+	for (; length >= 8; length -= 8, rombase += 8)
+		AccumCRC = crc32_update64(AccumCRC, load64_ci(rombase));
+	while (length-- > 0)
+		AccumCRC = crc32_update8(AccumCRC, load8_ci(rombase++));
 
 	return AccumCRC;
 }
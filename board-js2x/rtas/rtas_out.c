@@ -19,6 +19,7 @@
 #include <rtas.h>
 #include <hw.h>
 #include "rtas_board.h"
+#include <crc32.h>
 
 volatile unsigned char *uart;
 volatile unsigned char u4Flag;
@@ -89,31 +90,32 @@ unsigned long
 check_flash_image(unsigned long rombase, unsigned long length,
 		  unsigned long start_crc)
 {
-	const uint32_t CrcTableHigh[16] = {
-		0x00000000, 0x4C11DB70, 0x9823B6E0, 0xD4326D90,
-		0x34867077, 0x7897AB07, 0xACA5C697, 0xE0B41DE7,
-		0x690CE0EE, 0x251D3B9E, 0xF12F560E, 0xBD3E8D7E,
-		0x5D8A9099, 0x119B4BE9, 0xC5A92679, 0x89B8FD09
-	};
-	const uint32_t CrcTableLow[16] = {
-		0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
-		0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
-		0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
-		0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
-	};
-
-	char *Buffer = (char *) rombase;
+	unsigned char *Buffer = (unsigned char *) rombase;
 	uint32_t AccumCRC = start_crc;
-	char val;
-	uint32_t Temp;
+	uint64_t val;
+	uint8_t byte;
+
+	crc32_init();
+
+	while (length > 0 && ((unsigned long) Buffer & 7)) {
+		set_ci();
+		byte = *Buffer;
+		clr_ci();
+		AccumCRC = crc32_update8(AccumCRC, byte);
+		++Buffer;
+		--length;
+	}
+	for (; length >= 8; length -= 8, Buffer += 8) {
+		set_ci();
+		val = *(uint64_t *) Buffer;
+		clr_ci();
+		AccumCRC = crc32_update64(AccumCRC, val);
+	}
 	while (length-- > 0) {
 		set_ci();
-		val = *Buffer;
+		byte = *Buffer;
 		clr_ci();
-		Temp = ((AccumCRC >> 24) ^ val) & 0x000000ff;
-		AccumCRC <<= 8;
-		AccumCRC ^= CrcTableHigh[Temp / 16];
-		AccumCRC ^= CrcTableLow[Temp % 16];
+		AccumCRC = crc32_update8(AccumCRC, byte);
 		++Buffer;
 	}
 	return AccumCRC;
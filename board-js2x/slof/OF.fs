@@ -15,6 +15,7 @@
 hex
 
 ' ll-cr to cr
+' ll-type to type
 
 \ as early as possible we want to know if it is js20, js21 or bimini
 \ u3 = js20; u4 = js21/bimini
@@ -208,6 +209,7 @@ d# 14318378 VALUE tb-frequency   \ default value - needed for "ms" to work
 260 cp
 
 #include <timebase.fs>
+#include <timeline.fs>
 
 270 cp
 
@@ -101,6 +101,30 @@ static void load_file(uint64_t destAddr, char *name, uint64_t maxSize,
 	flush_cache((void *) destAddr, fileInfo.size_data);
 }
 
+/*
+ * Returns the number of bytes that the ROMFS image at rom_addr occupies,
+ * i.e. the end of the file that ends last, but at most max_size.
+ * memcpy() is used for reading since the image usually sits at address 0.
+ */
+static uint64_t romfs_image_size(uint64_t rom_addr, uint64_t max_size)
+{
+	uint64_t pos = 0, end = 0, file_end;
+	uint64_t next, len, dptr;
+
+	do {
+		memcpy(&next, (void *)(rom_addr + pos + ROMFS_HDR_NEXT), 8);
+		memcpy(&len, (void *)(rom_addr + pos + ROMFS_HDR_LEN), 8);
+		memcpy(&dptr, (void *)(rom_addr + pos + ROMFS_HDR_DPTR), 8);
+		/* data is padded to 8 bytes and followed by an end marker */
+		file_end = pos + dptr + ((len + 7) & ~7ULL) + 8;
+		if (file_end > end)
+			end = file_end;
+		pos += next;
+	} while (next && pos < max_size);
+
+	return end < max_size ? end : max_size;
+}
+
 /***************************************************************************
  * Function: early_c_entry
  * Input   : start_addr
@@ -127,7 +151,8 @@ void early_c_entry(uint64_t start_addr, uint64_t fdt_addr)
 	 * QEMU loads the FDT at the top of the available RAM, so we place
 	 * the ROMFS just underneath. */
 	romfs_base = (fdt_addr - 0x410000) & ~0xffffLL;
-	memcpy((char *)romfs_base, 0, 0x400000);
+	/* Only copy the part of the 4 MiB flash area that holds files */
+	memcpy((char *)romfs_base, 0, romfs_image_size(0, 0x400000));
 
 	exception_stack_frame = 0;
 
@@ -15,6 +15,7 @@
 hex
 
 ' ll-cr to cr
+' ll-type to type
 
 #include "header.fs"
 
@@ -92,6 +93,7 @@ d# 512000000 VALUE tb-frequency   \ default value - needed for "ms" to work
 260 cp
 
 #include <timebase.fs>
+#include <timeline.fs>
 
 270 cp
 
@@ -63,6 +63,11 @@ INSTANCE VARIABLE obp-tftp-package
    THEN
 ;
 
+\ Let the NIC complete the UDP checksums of the frames passed to "write"
+: set-tx-csum  ( enable? -- supported? )
+   e1k-set-tx-csum
+;
+
 : load  ( addr -- len )
    s" load" obp-tftp-package @ $call-method
 ;
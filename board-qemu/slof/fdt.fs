@@ -203,7 +203,9 @@ fdt-check-header
 : fdt-unflatten-tree
     fdt-debug IF
         ." Unflattening device tree..." cr THEN
+    s" fdt-unflatten" timeline-begin
     fdt-struct fdt-unflatten-node drop
+    s" fdt-unflatten" timeline-end
     fdt-debug IF
         ." Done !" cr THEN
 ;
@@ -11,14 +11,19 @@
 \ ****************************************************************************/
 
 \ PAPR hvterm console.  Enabled very early.
+\ Output is buffered and sent 16 bytes per hypercall.  The buffer is
+\ flushed on newline, at the end of every type, and whenever the console
+\ is polled for input.
 
 0 CONSTANT default-hvtermno
 
-: hvterm-emit  default-hvtermno SWAP hv-putchar ;
+: hvterm-emit  default-hvtermno SWAP hv-putchar-buffered ;
+: hvterm-type  ll-type hv-flush ;
 : hvterm-key?  default-hvtermno hv-haschar ;
 : hvterm-key   BEGIN hvterm-key? UNTIL default-hvtermno hv-getchar ;
 
 ' hvterm-emit to emit
+' hvterm-type to type
 ' hvterm-key  to key
 ' hvterm-key? to key?
 
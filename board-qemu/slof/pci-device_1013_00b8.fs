@@ -100,10 +100,11 @@ false VALUE is-installed?
          drop ( adr x y w adr x y )
          i + screen-width * + \ calculate offset into framebuffer ((y + i) * screen_width + x) 
          ( adr x y w adr offs ) 
-         frame-buffer-adr + \ add to frame-buffer-adr ( adr x y w adr fb_adr ) 
-         1 pick 3 pick i * + swap 3 pick ( adr x y w adr adr_offs fb_adr w )
-         rmove \ copy line ( adr x y w adr )
-         drop ( adr x y w )
+         swap 2 pick i * + swap ( adr x y w adr_offs offs )
+         2dup 4 pick fb8-shadow-move \ keep the shadow of fbuffer.fs in sync
+         frame-buffer-adr + \ add to frame-buffer-adr ( adr x y w adr_offs fb_adr )
+         2 pick ( adr x y w adr_offs fb_adr w )
+         rmove \ copy line ( adr x y w )
       LOOP
       4drop
    ELSE
@@ -118,6 +119,7 @@ false VALUE is-installed?
          drop ( number x y w number x y )
          i + screen-width * + \ calculate offset into framebuffer ((y + i) * screen_width + x) 
          ( number x y w number offs ) 
+         2dup 4 pick fb8-shadow-fill \ keep the shadow of fbuffer.fs in sync
          frame-buffer-adr + \ add to frame-buffer-adr ( number x y w number adr ) 
          2 pick 2 pick ( number x y w number adr w number )
          rfill \ draw line ( number x y w number )
@@ -16,6 +16,7 @@
 0 VALUE my-nvram-store
 0 VALUE my-nvram-size
 0 VALUE nvram-addr
+0 VALUE nvram-shadow
 
 : open true ;
 : close ;
@@ -42,7 +43,11 @@
     " nvram-store" rtas-get-token to my-nvram-store
     my-nvram-size to nvram-size
     nvram-size alloc-mem to nvram-addr
-    my-nvram-fetch my-nvram-store nvram-size nvram-addr internal-nvram-init
+    nvram-size alloc-mem to nvram-shadow
+    my-nvram-fetch my-nvram-store nvram-size nvram-addr nvram-shadow
+    internal-nvram-init
+    \ Write back what is still pending in the RAM copy before we leave
+    ['] nvram-sync add-quiesce-xt
 THEN
 
 setup-alias
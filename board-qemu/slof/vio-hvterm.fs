@@ -16,12 +16,7 @@
 : close ;
 
 : write ( adr len -- actual )
-   tuck
-   0 ?DO
-       dup c@ my-unit SWAP hv-putchar
-       1 +
-   LOOP
-   drop
+   dup >r my-unit -rot hv-putbuf r>
 ;
 
 : read  ( adr len -- actual )
@@ -39,3 +34,6 @@
 ;
 
 setup-alias
+
+\ Buffered console output must be out before the OS takes over the hvterm
+' hv-flush add-quiesce-xt
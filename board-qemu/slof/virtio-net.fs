@@ -69,6 +69,11 @@ virtiodev virtio-setup-vd
    THEN
 ;
 
+\ Let the NIC complete the UDP checksums of the frames passed to "write"
+: set-tx-csum  ( enable? -- supported? )
+   virtio-net-set-tx-csum
+;
+
 : load  ( addr -- len )
    s" load" obp-tftp-package @ $call-method 
 ;
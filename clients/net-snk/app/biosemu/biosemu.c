@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include <cpu.h>
+#include <cache.h>
 
 #include "debug.h"
 
@@ -101,38 +102,15 @@ biosemu(char argc, char **argv)
 		     (int) M.mem_size);
 
 	// copy expansion ROM image to segment OPTION_ROM_CODE_SEGMENT
-	// NOTE: this sometimes fails, some bytes are 0x00... so we compare
-	// after copying and do some retries...
+	// NOTE: this sometimes fails, some bytes are 0x00... so ci_rom_copy
+	// verifies the copy where needed and we do some retries...
 	uint8_t *mem_img = biosmem + (OPTION_ROM_CODE_SEGMENT << 4);
 	uint8_t copy_count = 0;
 	uint8_t cmp_result = 0;
 	do {
-#if 0
-		set_ci();
-		memcpy(mem_img, rom_image, len);
-		clr_ci();
-#else
-		// memcpy fails... try copy byte-by-byte with set/clr_ci
-		uint8_t c;
-		for (i = 0; i < bios_device.img_size; i++) {
-			set_ci();
-			c = *(rom_image + i);
-			if (c != *(rom_image + i)) {
-				clr_ci();
-				printf("Copy failed at: %x/%x\n", i,
-				       bios_device.img_size);
-				printf("rom_image(%x): %x, mem_img(%x): %x\n",
-				       i, *(rom_image + i), i, *(mem_img + i));
-				break;
-			}
-			clr_ci();
-			*(mem_img + i) = c;
-		}
-#endif
+		cmp_result = ci_rom_copy(mem_img, rom_image,
+					 bios_device.img_size);
 		copy_count++;
-		set_ci();
-		cmp_result = memcmp(mem_img, rom_image, bios_device.img_size);
-		clr_ci();
 	}
 	while ((copy_count < 5) && (cmp_result != 0));
 	if (cmp_result != 0) {
@@ -169,12 +169,76 @@ extern uint64_t get_time(void);
 
 void update_time(uint32_t);
 
+// dev_translate_address checks the legacy VGA window and walks the whole
+// translate_address_array for every single access, so its result is cached
+// per page. Only pages that are translated uniformly (i.e. lie completely
+// inside or outside of every range) are cached, all others are still
+// translated for each access.
+#define MEM_TLB_PAGE_SHIFT 12
+#define MEM_TLB_ENTRIES 64
+
+typedef struct {
+	uint32_t tag;		// page number + 1, 0 means invalid
+	uint8_t translated;
+	uint64_t offset;
+} mem_tlb_entry_t;
+
+static mem_tlb_entry_t mem_tlb[MEM_TLB_ENTRIES];
+
+// fill TLB entry for page, returns 0 if the page cannot be cached
+static uint8_t
+mem_tlb_fill(mem_tlb_entry_t * entry, uint32_t page)
+{
+	uint64_t start = (uint64_t) page << MEM_TLB_PAGE_SHIFT;
+	uint64_t end = start + (1 << MEM_TLB_PAGE_SHIFT) - 1;
+	uint8_t translated = 0;
+	uint64_t offset = 0;
+	translate_address_t ta;
+	int i;
+
+	// legacy VGA memory is not mapped linearly into the vmem BAR
+	if ((bios_device.vmem_size > 0) && (end >= 0xA0000)
+	    && (start < 0xC0000))
+		return 0;
+	// same ranges as in dev_translate_address, first match wins
+	for (i = 0; i <= taa_last_entry; i++) {
+		ta = translate_address_array[i];
+		if ((end < ta.address) || (start > (ta.address + ta.size)))
+			continue;
+		if ((start < ta.address) || (end > (ta.address + ta.size)))
+			return 0;
+		if (!translated) {
+			translated = 1;
+			offset = ta.address_offset;
+		}
+	}
+	entry->tag = page + 1;
+	entry->translated = translated;
+	entry->offset = offset;
+	return 1;
+}
+
+// same as dev_translate_address, but using the TLB
+static inline uint8_t
+mem_translate_address(uint32_t addr, uint64_t * translated_addr)
+{
+	uint32_t page = addr >> MEM_TLB_PAGE_SHIFT;
+	mem_tlb_entry_t *entry = &mem_tlb[page % MEM_TLB_ENTRIES];
+
+	if ((entry->tag != page + 1) && !mem_tlb_fill(entry, page)) {
+		*translated_addr = addr;
+		return dev_translate_address(translated_addr);
+	}
+	*translated_addr = addr + entry->offset;
+	return entry->translated;
+}
+
 // read byte from memory
 uint8_t
 my_rdb(uint32_t addr)
 {
-	uint64_t translated_addr = addr;
-	uint8_t translated = dev_translate_address(&translated_addr);
+	uint64_t translated_addr;
+	uint8_t translated = mem_translate_address(addr, &translated_addr);
 	uint8_t rval;
 	if (translated != 0) {
 		//translation successful, access VGA Memory (BAR or Legacy...)
@@ -205,8 +269,8 @@ my_rdb(uint32_t addr)
 uint16_t
 my_rdw(uint32_t addr)
 {
-	uint64_t translated_addr = addr;
-	uint8_t translated = dev_translate_address(&translated_addr);
+	uint64_t translated_addr;
+	uint8_t translated = mem_translate_address(addr, &translated_addr);
 	uint16_t rval;
 	if (translated != 0) {
 		//translation successful, access VGA Memory (BAR or Legacy...)
@@ -256,8 +320,8 @@ my_rdw(uint32_t addr)
 uint32_t
 my_rdl(uint32_t addr)
 {
-	uint64_t translated_addr = addr;
-	uint8_t translated = dev_translate_address(&translated_addr);
+	uint64_t translated_addr;
+	uint8_t translated = mem_translate_address(addr, &translated_addr);
 	uint32_t rval;
 	if (translated != 0) {
 		//translation successful, access VGA Memory (BAR or Legacy...)
@@ -319,8 +383,8 @@ my_rdl(uint32_t addr)
 void
 my_wrb(uint32_t addr, uint8_t val)
 {
-	uint64_t translated_addr = addr;
-	uint8_t translated = dev_translate_address(&translated_addr);
+	uint64_t translated_addr;
+	uint8_t translated = mem_translate_address(addr, &translated_addr);
 	if (translated != 0) {
 		//translation successful, access VGA Memory (BAR or Legacy...)
 		DEBUG_PRINTF_MEM("%s(%x, %x): access to VGA Memory\n",
@@ -344,8 +408,8 @@ my_wrb(uint32_t addr, uint8_t val)
 void
 my_wrw(uint32_t addr, uint16_t val)
 {
-	uint64_t translated_addr = addr;
-	uint8_t translated = dev_translate_address(&translated_addr);
+	uint64_t translated_addr;
+	uint8_t translated = mem_translate_address(addr, &translated_addr);
 	if (translated != 0) {
 		//translation successful, access VGA Memory (BAR or Legacy...)
 		DEBUG_PRINTF_MEM("%s(%x, %x): access to VGA Memory\n",
@@ -389,8 +453,8 @@ my_wrw(uint32_t addr, uint16_t val)
 void
 my_wrl(uint32_t addr, uint32_t val)
 {
-	uint64_t translated_addr = addr;
-	uint8_t translated = dev_translate_address(&translated_addr);
+	uint64_t translated_addr;
+	uint8_t translated = mem_translate_address(addr, &translated_addr);
 	if (translated != 0) {
 		//translation successful, access VGA Memory (BAR or Legacy...)
 		DEBUG_PRINTF_MEM("%s(%x, %x): access to VGA Memory\n",
@@ -13,14 +13,16 @@
 #include <netlib/tftp.h>
 #include <netlib/ethernet.h>
 #include <netlib/dhcp.h>
-//#include <netlib/dhcpv6.h>
+#include <netlib/dhcpv6.h>
 #include <netlib/ipv4.h>
-//#include <netlib/ipv6.h>
+#include <netlib/ipv6.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
 #include <sys/socket.h>
+#include <ioctl.h>
+#include <netdriver_int.h>
 #include <netapps/args.h>
 #include <libbootmsg/libbootmsg.h>
 #include <of.h>
@@ -41,11 +43,11 @@ typedef struct {
 	char filename[100];
 	int  ip_init;
 	char siaddr[4];
-	//ip6_addr_t si6addr;
+	ip6_addr_t si6addr;
 	char ciaddr[4];
-	//ip6_addr_t ci6addr;
+	ip6_addr_t ci6addr;
 	char giaddr[4];
-	//ip6_addr_t gi6addr;
+	ip6_addr_t gi6addr;
 	int  bootp_retries;
 	int  tftp_retries;
 } obp_tftp_args_t;
@@ -60,7 +62,6 @@ typedef struct {
  * @param  obp_tftp_args  structure which contains the result
  * @return                updated arg_str
  */
-/*
 static const char * 
 parse_ipv6args (const char *arg_str, unsigned int argc,
 		obp_tftp_args_t *obp_tftp_args)
@@ -137,7 +138,6 @@ parse_ipv6args (const char *arg_str, unsigned int argc,
 
 	return arg_str;
 }
-*/
 
 
 /**
@@ -272,11 +272,9 @@ parse_args(const char *arg_str, obp_tftp_args_t *obp_tftp_args)
 	if (ip_version == 4) {
 		arg_str = parse_ipv4args (arg_str, argc, obp_tftp_args);
 	}
-/*
 	else if (ip_version == 6) {
 		arg_str = parse_ipv6args (arg_str, argc, obp_tftp_args);
 	}
-*/
 
 	// find out bootp-retries
 	if (argc == 0)
@@ -324,15 +322,14 @@ netboot(int argc, char *argv[])
 	tftp_err_t tftp_err;
 	obp_tftp_args_t obp_tftp_args;
 	char null_ip[4] = { 0x00, 0x00, 0x00, 0x00 };
-/*
 	char null_ip6[16] = { 0x00, 0x00, 0x00, 0x00,
 			     0x00, 0x00, 0x00, 0x00,
 			     0x00, 0x00, 0x00, 0x00, 
 			     0x00, 0x00, 0x00, 0x00 };
-*/
 	int huge_load = strtol(argv[4], 0, 10);
 	int32_t block_size = strtol(argv[5], 0, 10);
 	uint8_t own_mac[6];
+	ioctl_net_data_t ioctl_data;
 
 	printf("\n");
 	printf(" Bootloader 1.6 \n");
@@ -382,6 +379,12 @@ netboot(int argc, char *argv[])
 	// init ethernet layer
 	set_mac_address(own_mac);
 
+	// let the NIC complete the UDP checksums if the driver supports it
+	memset(&ioctl_data, 0, sizeof(ioctl_data));
+	ioctl_data.subcmd = ETHTOOL_STXCSUM;
+	ioctl_data.data.csum.enable = 1;
+	set_ipv4_csum_offload(ioctl(fd_device, SIOCETHTOOL, &ioctl_data) == 0);
+
 	if (argc > 6) {
 		parse_args(argv[6], &obp_tftp_args);
 		if(obp_tftp_args.bootp_retries - rc < DEFAULT_BOOT_RETRIES)
@@ -411,7 +414,6 @@ netboot(int argc, char *argv[])
 			obp_tftp_args.ip_init = IP_INIT_NONE;
 		}
 	}
-/*
 	else if (ip_version == 6) {
 		if (memcmp(&obp_tftp_args.ci6addr, null_ip6, 16) != 0
 		    && memcmp(&obp_tftp_args.si6addr, null_ip6, 16) != 0
@@ -425,7 +427,6 @@ netboot(int argc, char *argv[])
 			obp_tftp_args.ip_init = IP_INIT_DHCPV6_STATELESS;
 		}
 	}
-*/
 	// construction of fn_ip from parameter
 	switch(obp_tftp_args.ip_init) {
 	case IP_INIT_BOOTP:
@@ -447,15 +448,22 @@ netboot(int argc, char *argv[])
 		printf("  Requesting IP address via DHCP: ");
 		rc = dhcp(ret_buffer, &fn_ip, obp_tftp_args.bootp_retries);
 		break;
-/*
 	case IP_INIT_DHCPV6_STATELESS:
+		printf("  Requesting boot file via DHCPv6: ");
 		set_ipv6_address(0);
 		rc = do_dhcpv6 (ret_buffer, &fn_ip, 10, DHCPV6_STATELESS);
 		break;
 	case IP_INIT_IPV6_MANUAL:
+		printf("  Using IPv6 address: ");
 		set_ipv6_address(&obp_tftp_args.ci6addr);
+		// use the given gateway or ask the routers on the link
+		if (obp_tftp_args.gi6addr.part[0] ||
+		    obp_tftp_args.gi6addr.part[1])
+			ipv6_set_router(&obp_tftp_args.gi6addr, NULL);
+		else
+			ipv6_find_router();
+		memcpy(&fn_ip.own_ip6, get_ipv6_address(), 16);
 		break;
-*/
 	case IP_INIT_NONE:
 	default:
 		break;
@@ -473,7 +481,6 @@ netboot(int argc, char *argv[])
 		// init IPv4 layer
 		set_ipv4_address(fn_ip.own_ip);
 	}
-/*
 	else if (rc >= 0 && ip_version == 6) {
 		if(memcmp(&obp_tftp_args.ci6addr.addr, null_ip6, 16) != 0
 		&& memcmp(&obp_tftp_args.ci6addr.addr, &fn_ip.own_ip6, 16) != 0)
@@ -483,7 +490,6 @@ netboot(int argc, char *argv[])
 		&& memcmp(&obp_tftp_args.si6addr.addr, &fn_ip.server_ip6.addr, 16) != 0)
 			memcpy(&fn_ip.server_ip6.addr, &obp_tftp_args.si6addr.addr, 16);
 	}
-*/
 	if (rc == -1) {
 		strcpy(buf,"E3001: (net) Could not get IP address");
 		bootmsg_error(0x3001, &buf[7]);
@@ -492,9 +498,15 @@ netboot(int argc, char *argv[])
 		return -101;
 	}
 
-	printf("%d.%d.%d.%d\n",
-	       ((fn_ip.own_ip >> 24) & 0xFF), ((fn_ip.own_ip >> 16) & 0xFF),
-	       ((fn_ip.own_ip >>  8) & 0xFF), ( fn_ip.own_ip        & 0xFF));
+	if (ip_version == 4) {
+		printf("%d.%d.%d.%d\n",
+		       ((fn_ip.own_ip >> 24) & 0xFF), ((fn_ip.own_ip >> 16) & 0xFF),
+		       ((fn_ip.own_ip >>  8) & 0xFF), ( fn_ip.own_ip        & 0xFF));
+	}
+	else {
+		ipv6_to_str(fn_ip.own_ip6.addr, buf);
+		printf("%s\n", buf);
+	}
 
 	if (rc == -2) {
 		sprintf(buf,
@@ -529,12 +541,19 @@ netboot(int argc, char *argv[])
 		fn_ip.filename[sizeof(fn_ip.filename)-1] = 0;
 	}
 
-	printf("  Requesting file \"%s\" via TFTP from %d.%d.%d.%d\n",
-		fn_ip.filename,
-		((fn_ip.server_ip >> 24) & 0xFF),
-		((fn_ip.server_ip >> 16) & 0xFF),
-		((fn_ip.server_ip >>  8) & 0xFF),
-		( fn_ip.server_ip        & 0xFF));
+	if (ip_version == 4) {
+		printf("  Requesting file \"%s\" via TFTP from %d.%d.%d.%d\n",
+			fn_ip.filename,
+			((fn_ip.server_ip >> 24) & 0xFF),
+			((fn_ip.server_ip >> 16) & 0xFF),
+			((fn_ip.server_ip >>  8) & 0xFF),
+			( fn_ip.server_ip        & 0xFF));
+	}
+	else {
+		ipv6_to_str(fn_ip.server_ip6.addr, buf);
+		printf("  Requesting file \"%s\" via TFTP from %s\n",
+			fn_ip.filename, buf);
+	}
 
 	// accept at most 20 bad packets
 	// wait at most for 40 packets
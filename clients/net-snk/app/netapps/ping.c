@@ -37,6 +37,13 @@ struct ping_args {
 	unsigned int timeout;
 };
 
+/* the answer has arrived when pong_ipv4() is reset to 0 */
+static int32_t
+ping_done(void)
+{
+	return pong_ipv4() == 0;
+}
+
 static void
 usage(void)
 {
@@ -180,13 +187,10 @@ ping(int argc, char *argv[])
 
 	ping_ipv4(fn_ip.server_ip);
 
-	set_timer(TICKS_SEC / 10 * ping_args.timeout);
-	while(get_timer() > 0) {
-		receive_ether();
-		if(pong_ipv4() == 0) {
-			printf("success\n");
-			return 0;
-		}
+	// timeout is given in tenths of a second
+	if (net_poll(100 * ping_args.timeout, ping_done)) {
+		printf("success\n");
+		return 0;
 	}
 
 	printf("failed\n");
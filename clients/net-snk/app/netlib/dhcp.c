@@ -37,6 +37,18 @@
  *        +----------------------> * SUCCESS *
  *                                 ***********
  *
+ * If a lease of an earlier boot is cached in NVRAM, the client first
+ * starts in REQUEST state and asks for the same address again
+ * (INIT-REBOOT, RFC 2131 3.2). If that fails, it continues with INIT.
+ *
+ * The time to wait for an answer starts with DHCP_INITIAL_WAIT seconds and
+ * doubles with each Discover up to DHCP_MAX_WAIT seconds. Each wait is
+ * randomized by +/- one second (RFC 2131 4.1), so that clients which are
+ * powered on at the same time do not retry in lockstep. The retries given
+ * to dhcp() are a time budget of DHCP_RETRY_TIME each, the time that one
+ * request took before the backoff, so the total time (and the watchdog
+ * set by the firmware) does not depend on the backoff.
+ *
  * ************************************************************************
  * </pre> */
 
@@ -48,10 +60,12 @@
 #include <ipv4.h>
 #include <udp.h>
 #include <dns.h>
+#include <of.h>
 
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <kernel.h>
 #include <sys/socket.h>
 #include <ctype.h>
 #include <stdlib.h>
@@ -91,6 +105,16 @@
 #define DHCP_STATE_SUCCESS     3
 #define DHCP_STATE_FAULT       4
 
+/* Timeouts in seconds */
+#define DHCP_INITIAL_WAIT      4
+#define DHCP_MAX_WAIT         64
+#define DHCP_REBOOT_WAIT       2
+
+/* Time budget per retry in milliseconds */
+#define DHCP_RETRY_TIME     2000
+
+#define DHCP_CACHE_MAGIC    0x44484350 /* "DHCP" */
+
 static uint8_t dhcp_magic[] = {0x63, 0x82, 0x53, 0x63};
 /**< DHCP_magic is a cookie, that identifies DHCP options (see RFC 2132) */
 
@@ -109,7 +133,8 @@ typedef struct {
 	                                  option will be requested from server */
 	uint32_t   server_ID;         /**< o.54 Identifies DHCP-server         */
 	uint32_t   requested_IP;      /**< o.50 Must be filled in DHCP-Request */
-	uint32_t   dns_IP;            /**< o. 6 DNS IP                         */
+	uint32_t   dns_IP[DNS_SERVERS]; /**< o. 6 DNS IPs                      */
+	uint8_t    dns_count;         /**< o. 6 Number of DNS IPs              */
 	uint32_t   router_IP;         /**< o. 3 Router IP                      */
 	uint32_t   subnet_mask;       /**< o. 1 Subnet mask                    */
 	uint8_t    msg_type;          /**< o.53 DHCP-message type              */
@@ -118,6 +143,18 @@ typedef struct {
 	int8_t     bootfile[256];     /**< o.67 Boot file name                 */
 } dhcp_options_t;
 
+/** \struct dhcp_cache
+ *  The last lease, stored in NVRAM by the firmware
+ *  (see ibm,dhcp-cache-read / ibm,dhcp-cache-write in client.fs).
+ */
+struct dhcp_cache {
+	uint32_t magic;      /**< DHCP_CACHE_MAGIC                      */
+	uint8_t  mac[6];     /**< Client HW address the lease belongs to */
+	uint16_t reserved;
+	uint32_t own_ip;     /**< Leased IP address                      */
+	uint32_t server_ip;  /**< DHCP server which granted the lease    */
+};
+
 /** Stores state of DHCP-client (refer to State-transition diagram) */
 static uint8_t dhcp_state;
 
@@ -125,7 +162,19 @@ static uint8_t dhcp_state;
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>> PROTOTYPES <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 static int32_t
-dhcp_attempt(void);
+dhcp_attempt(int32_t msecs);
+
+static int32_t
+dhcp_reboot_attempt(void);
+
+static int32_t
+dhcp_wait(int32_t msecs);
+
+static int32_t
+dhcp_done(void);
+
+static void
+dhcp_cache_store(void);
 
 static int32_t
 dhcp_encode_options(uint8_t * opt_field, dhcp_options_t * opt_struct);
@@ -168,6 +217,7 @@ static uint32_t dhcp_server_ip     = 0;
 static uint32_t dhcp_siaddr_ip     = 0;
 static int8_t   dhcp_filename[256];
 static int8_t   dhcp_tftp_name[256];
+static uint32_t dhcp_xid;
 
 static char   * response_buffer;
 
@@ -181,12 +231,17 @@ static char   * response_buffer;
  * @param  fn_ip         contains the following configuration information:
  *                       client MAC, client IP, TFTP-server MAC, 
  *                       TFTP-server IP, Boot file name
+ * @param  retries       time budget in units of DHCP_RETRY_TIME
  * @return               ZERO - IP and configuration info obtained;
  *                       NON ZERO - error condition occurs.
  */
 int32_t
 dhcp(char *ret_buffer, filename_ip_t * fn_ip, unsigned int retries) {
-	int i = (int) retries+1;
+	int64_t budget = (int64_t) retries * DHCP_RETRY_TIME;
+	int32_t wait = DHCP_INITIAL_WAIT;
+	int32_t msecs, rc;
+	int requests = 0;
+	const uint8_t *mac = get_mac_address();
 
 	uint32_t dhcp_tftp_ip     = 0;
 	strcpy((char *) dhcp_filename, "");
@@ -194,21 +249,42 @@ dhcp(char *ret_buffer, filename_ip_t * fn_ip, unsigned int retries) {
 
 	response_buffer = ret_buffer;
 
+	// every client needs its own random sequence
+	srand(get_time() ^ ((uint32_t) mac[2] << 24 | mac[3] << 16 |
+	                    mac[4] << 8 | mac[5]));
+	dhcp_xid = (rand() << 16) ^ rand();
+
 	printf("    ");
 
-	do {
-		printf("\b\b\b%03d", i-1);
-		if (getchar() == 27) {
-			printf("\nAborted\n");
+	rc = dhcp_reboot_attempt();
+	while (!rc) {
+		printf("\b\b\b%03d", (int) (budget / DHCP_RETRY_TIME));
+		if (getchar() == 27)
+			rc = -1;
+		else if (budget <= 0) {
+			printf("\nGiving up after %d DHCP requests\n", requests);
 			return -1;
 		}
-		if (!--i) {
-			printf("\nGiving up after %d DHCP requests\n", retries);
-			return -1;
+		else {
+			// randomized wait, but not beyond the time budget
+			msecs = wait * 1000 - 1000 + rand() % 2001;
+			if (msecs > budget)
+				msecs = budget;
+			budget -= msecs;
+			requests++;
+			rc = dhcp_attempt(msecs);
+			if (wait < DHCP_MAX_WAIT)
+				wait *= 2;
 		}
-	} while (!dhcp_attempt());
+	}
+	if (rc < 0) {
+		printf("\nAborted\n");
+		return -1;
+	}
 	printf("\b\b\b\b");
 
+	dhcp_cache_store();
+
 	if (fn_ip->own_ip) {
 		dhcp_own_ip = fn_ip->own_ip;
 	}
@@ -256,36 +332,119 @@ dhcp(char *ret_buffer, filename_ip_t * fn_ip, unsigned int retries) {
 
 /**
  * DHCP: Tries o obtain DHCP parameters, refer to state-transition diagram
+ *
+ * @param  msecs         milliseconds to wait for the server
+ * @return               see dhcp_wait
  */
 static int32_t
-dhcp_attempt(void) {
-	int sec;
-
+dhcp_attempt(int32_t msecs) {
 	// Send DISCOVER message and switch DHCP-client to SELECT state
 	dhcp_send_discover();
 
 	dhcp_state = DHCP_STATE_SELECT;
 
-	// setting up a timer with a timeout of two seconds
-	for (sec = 0; sec < 2; sec++) {
-		set_timer(TICKS_SEC);
-		do {
-			receive_ether();
-
-			// Wait until client will switch to Final state or Timeout occurs
-			switch (dhcp_state) {
-			case DHCP_STATE_SUCCESS :
-				return 1;
-			case DHCP_STATE_FAULT :
-				return 0;
-			}
-		} while (get_timer() > 0);
+	return dhcp_wait(msecs);
+}
+
+/**
+ * DHCP: Tries to get the lease cached in NVRAM again (INIT-REBOOT).
+ *       The server answers with an ACK, which carries the current
+ *       configuration (boot file, TFTP server, ...) as usual, or a NACK.
+ *
+ * @return               see dhcp_wait; ZERO if there is no cached lease
+ */
+static int32_t
+dhcp_reboot_attempt(void) {
+	struct dhcp_cache cache;
+	int32_t rc;
+
+	if (dhcp_cache_read((char *) &cache, sizeof(cache)) != sizeof(cache) ||
+	    cache.magic != DHCP_CACHE_MAGIC || !cache.own_ip ||
+	    memcmp(cache.mac, get_mac_address(), 6))
+		return 0;
+
+	// a Request without server ID asks for the address of an old lease
+	dhcp_own_ip = cache.own_ip;
+	dhcp_server_ip = 0;
+	dhcp_send_request();
+
+	dhcp_state = DHCP_STATE_REQUEST;
+
+	rc = dhcp_wait(DHCP_REBOOT_WAIT * 1000);
+	if (rc <= 0) {
+		dhcp_own_ip = 0;
+		dhcp_server_ip = 0;
+	}
+	return rc;
+}
+
+/**
+ * DHCP: Handles received packets until the client reaches a final state
+ *       or the time is over.
+ *
+ * @param  msecs         time to wait in milliseconds
+ * @return               1 - SUCCESS state reached;
+ *                       0 - FAULT state reached or timeout;
+ *                       -1 - aborted by the user
+ */
+static int32_t
+dhcp_wait(int32_t msecs) {
+	int32_t slice, rc;
+
+	// ESC is checked every second
+	while (msecs > 0) {
+		slice = msecs < 1000 ? msecs : 1000;
+		msecs -= slice;
+
+		// Wait until client will switch to Final state or Timeout occurs
+		rc = net_poll(slice, dhcp_done);
+		if (rc)
+			return rc == DHCP_STATE_SUCCESS;
+
+		if (getchar() == 27)
+			return -1;
 	}
 
 	// timeout 
 	return 0;
 }
 
+/**
+ * DHCP: Tells net_poll whether the client has reached a final state.
+ *
+ * @return  DHCP_STATE_SUCCESS or DHCP_STATE_FAULT; ZERO - still waiting
+ */
+static int32_t
+dhcp_done(void) {
+	if (dhcp_state == DHCP_STATE_SUCCESS || dhcp_state == DHCP_STATE_FAULT)
+		return dhcp_state;
+	return 0;
+}
+
+/**
+ * DHCP: Remembers the lease in NVRAM for the next boot. NVRAM is only
+ *       written if the lease has changed.
+ */
+static void
+dhcp_cache_store(void) {
+	struct dhcp_cache cache, old;
+
+	if (!dhcp_own_ip || !dhcp_server_ip)
+		return;
+
+	memset(&cache, 0, sizeof(cache));
+	cache.magic = DHCP_CACHE_MAGIC;
+	memcpy(cache.mac, get_mac_address(), 6);
+	cache.own_ip = dhcp_own_ip;
+	cache.server_ip = dhcp_server_ip;
+
+	if (dhcp_cache_read((char *) &old, sizeof(old)) == sizeof(old) &&
+	    !memcmp(&old, &cache, sizeof(cache)))
+		return;
+
+	dhcp_cache_write((char *) &cache, sizeof(cache));
+}
+
 /**
  * DHCP: Supplements DHCP-message with options stored in structure.
  *       For more information about option coding see dhcp_options_t.
@@ -397,6 +556,7 @@ static int32_t
 dhcp_decode_options(uint8_t opt_field[], uint32_t opt_len,
                     dhcp_options_t * opt_struct) {
 	int32_t offset = 0;
+	int32_t i;
 
 	memset(opt_struct, 0, sizeof(dhcp_options_t));
 
@@ -427,7 +587,10 @@ dhcp_decode_options(uint8_t opt_field[], uint32_t opt_len,
 
 		case DHCP_DNS :
 			opt_struct -> flag[DHCP_DNS] = 1;
-			opt_struct -> dns_IP = htonl(* (uint32_t *) (opt_field + offset + 2));
+			// the option lists the servers in order of preference
+			for (i = 0; i < opt_field[offset + 1] / 4 && i < DNS_SERVERS; ++i)
+				opt_struct -> dns_IP[i] = htonl(* (uint32_t *) (opt_field + offset + 2 + 4 * i));
+			opt_struct -> dns_count = i;
 			offset += 2 + opt_field[offset + 1]; 
 			break;
 
@@ -626,6 +789,7 @@ dhcp_send_discover(void) {
 	btph -> op = 1;
 	btph -> htype = 1;
 	btph -> hlen = 6;
+	btph -> xid = dhcp_xid;
 	memcpy(btph -> chaddr, get_mac_address(), 6);
 
 	memset(&opt, 0, sizeof(dhcp_options_t));
@@ -668,6 +832,7 @@ dhcp_send_request(void) {
 	btph -> op = 1;
 	btph -> htype = 1;
 	btph -> hlen = 6;
+	btph -> xid = dhcp_xid;
 	memcpy(btph -> chaddr, get_mac_address(), 6);
 
 	memset(&opt, 0, sizeof(dhcp_options_t));
@@ -675,8 +840,11 @@ dhcp_send_request(void) {
 	opt.msg_type = DHCPREQUEST;
 	memcpy(&(opt.requested_IP), &dhcp_own_ip, 4);
 	opt.flag[DHCP_REQUESTED_IP] = 1;
-	memcpy(&(opt.server_ID), &dhcp_server_ip, 4);
-	opt.flag[DHCP_SERVER_ID] = 1;
+	// no server ID in INIT-REBOOT state
+	if (dhcp_server_ip) {
+		memcpy(&(opt.server_ID), &dhcp_server_ip, 4);
+		opt.flag[DHCP_SERVER_ID] = 1;
+	}
 
 	opt.request_list[DHCP_MASK] = 1;
 	opt.request_list[DHCP_DNS] = 1;
@@ -753,6 +921,7 @@ handle_dhcp(uint8_t * packet, int32_t packetsize) {
 	struct btphdr * btph;
 	struct iphdr * iph;
 	dhcp_options_t opt;
+	int i;
 
 	memset(&opt, 0, sizeof(dhcp_options_t));  
 	btph = (struct btphdr *) packet;
@@ -761,6 +930,10 @@ handle_dhcp(uint8_t * packet, int32_t packetsize) {
 	if (btph -> op != 2)
 		return -1; // it is not Boot Reply
 
+	if (btph -> xid != dhcp_xid ||
+	    memcmp(btph -> chaddr, get_mac_address(), 6))
+		return -1; // reply to another client
+
 	if(response_buffer) {
 		if(packetsize <= 1720)
 			memcpy(response_buffer, packet, packetsize);
@@ -941,7 +1114,9 @@ handle_dhcp(uint8_t * packet, int32_t packetsize) {
 
 		/* DNS-server */
 		if (opt.flag[DHCP_DNS]) {
-			dns_init(opt.dns_IP);
+			dns_init(opt.dns_IP[0]);
+			for (i = 1; i < opt.dns_count; ++i)
+				dns_add_server(opt.dns_IP[i]);
 		}
 	}
 
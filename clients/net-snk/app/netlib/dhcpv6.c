@@ -0,0 +1,309 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> ALGORITHMS <<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/** \file dhcpv6.c <pre>
+ * ********************** Stateless DHCPv6 client *************************
+ *
+ * The address of the client comes from the stateless autoconfiguration
+ * (see ipv6.c), so DHCPv6 is only used to get the boot file: an
+ * Information-Request (RFC 3736) is sent to All_DHCP_Relay_Agents_and_Servers
+ * (ff02::1:2), asking for the boot file URL option (RFC 5970). The URL must
+ * have the form "tftp://[server address]/file name".
+ *
+ * The Information-Request is retransmitted with doubling timeouts, starting
+ * with DHCPV6_INITIAL_WAIT up to DHCPV6_MAX_WAIT seconds. Router
+ * Advertisements that arrive in the meantime are processed, so the global
+ * address is usually known when the Reply arrives.
+ *
+ * ************************************************************************
+ * </pre> */
+
+/*>>>>>>>>>>>>>>>>>>>>> DEFINITIONS & DECLARATIONS <<<<<<<<<<<<<<<<<<<<<<*/
+
+#include <dhcpv6.h>
+#include <ipv6.h>
+#include <ethernet.h>
+#include <udp.h>
+#include <sys/socket.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DHCPV6_INITIAL_WAIT    1
+#define DHCPV6_MAX_WAIT       32
+
+#define DHCPV6_STATE_SELECT    0
+#define DHCPV6_STATE_SUCCESS   1
+
+static int32_t
+dhcpv6_parse_url(const char *url, int len);
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+static uint8_t        dhcpv6_packet[ETH_MTU_SIZE];
+static uint8_t        dhcpv6_state;
+static uint8_t        dhcpv6_xid[3];
+static uint16_t       dhcpv6_elapsed;    /**< in hundredths of a second */
+static filename_ip_t *dhcpv6_fn_ip;
+
+extern uint64_t get_time(void);
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>> IMPLEMENTATION <<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/**
+ * DHCPv6: Appends an option to a message.
+ *
+ * @param  ptr   place of the option in the message
+ * @param  code  option code
+ * @param  data  option data
+ * @param  len   length of data
+ * @return       pointer behind the option
+ */
+static uint8_t *
+dhcpv6_add_option(uint8_t *ptr, uint16_t code, const void *data,
+                  uint16_t len)
+{
+	struct dhcpv6_option *opt = (struct dhcpv6_option *) ptr;
+
+	opt->code = htons(code);
+	opt->len = htons(len);
+	memcpy(opt + 1, data, len);
+	return ptr + sizeof(struct dhcpv6_option) + len;
+}
+
+/**
+ * DHCPv6: Sends an Information-Request for the boot file URL.
+ */
+static void
+dhcpv6_send_info_request(void)
+{
+	static const uint8_t all_dhcp_servers[16] = {
+		0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 2 };
+	uint8_t duid[10], oro[2];
+	struct ip6hdr *ip6h = (struct ip6hdr *) dhcpv6_packet;
+	struct udphdr *udph = (struct udphdr *) (ip6h + 1);
+	struct dhcpv6hdr *dh = (struct dhcpv6hdr *) (udph + 1);
+	uint8_t *ptr = (uint8_t *) (dh + 1);
+	uint16_t elapsed = htons(dhcpv6_elapsed);
+	int udp_len;
+
+	memset(dhcpv6_packet, 0, sizeof(dhcpv6_packet));
+
+	dh->type = DHCPV6_INFORMATION_REQUEST;
+	memcpy(dh->transaction_id, dhcpv6_xid, 3);
+
+	// DUID-LL: type, hardware type and MAC address
+	duid[0] = 0;
+	duid[1] = DHCPV6_DUID_LL;
+	duid[2] = 0;
+	duid[3] = DHCPV6_HWTYPE_ETHERNET;
+	memcpy(&duid[4], get_mac_address(), 6);
+	ptr = dhcpv6_add_option(ptr, DHCPV6_OPTION_CLIENTID, duid, 10);
+
+	ptr = dhcpv6_add_option(ptr, DHCPV6_OPTION_ELAPSED_TIME, &elapsed, 2);
+
+	oro[0] = 0;
+	oro[1] = DHCPV6_OPTION_BOOT_URL;
+	ptr = dhcpv6_add_option(ptr, DHCPV6_OPTION_ORO, oro, 2);
+
+	udp_len = ptr - (uint8_t *) udph;
+	fill_udphdr((uint8_t *) udph, udp_len, UDPPORT_DHCPV6C,
+	            UDPPORT_DHCPV6S);
+	fill_ip6hdr((uint8_t *) ip6h, udp_len, IPTYPE_UDP, NULL,
+	            (ip6_addr_t *) all_dhcp_servers);
+
+	send_ipv6(dhcpv6_packet, sizeof(struct ip6hdr) + udp_len);
+}
+
+/**
+ * DHCPv6: Tells net_poll whether a usable Reply has arrived.
+ */
+static int32_t
+dhcpv6_done(void)
+{
+	return dhcpv6_state == DHCPV6_STATE_SUCCESS;
+}
+
+/**
+ * DHCPv6: Waits for the Reply and processes received packets meanwhile.
+ *
+ * @param  secs   time to wait
+ * @return        1 - Reply received; 0 - timeout;
+ *                -1 - aborted with ESC
+ */
+static int32_t
+dhcpv6_wait(int32_t secs)
+{
+	while (secs-- > 0) {
+		if (net_poll(1000, dhcpv6_done))
+			return 1;
+
+		if (dhcpv6_elapsed < 0xffff - 100)
+			dhcpv6_elapsed += 100;
+
+		if (getchar() == 27)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * DHCPv6: Gets the boot file name and the TFTP server from a DHCPv6 server
+ *         (makes several attempts).
+ *
+ * @param  ret_buffer    not used (there is no BOOTP reply for IPv6)
+ * @param  fn_ip         receives the own and the TFTP server address and
+ *                       the boot file name
+ * @param  retries       number of Information-Requests
+ * @param  mode          DHCPV6_STATELESS
+ * @return               ZERO - configuration info obtained;
+ *                       NON ZERO - error condition occurs.
+ */
+int
+do_dhcpv6(char *ret_buffer, filename_ip_t *fn_ip, unsigned int retries,
+          uint8_t mode)
+{
+	int i = (int) retries + 1;
+	int32_t wait = DHCPV6_INITIAL_WAIT;
+	int32_t rc = 0;
+
+	if (mode != DHCPV6_STATELESS) {
+		printf("\nOnly stateless DHCPv6 is supported\n");
+		return -1;
+	}
+
+	dhcpv6_fn_ip = fn_ip;
+	dhcpv6_elapsed = 0;
+	srand(get_time());
+	dhcpv6_xid[0] = rand();
+	dhcpv6_xid[1] = rand();
+	dhcpv6_xid[2] = rand();
+
+	printf("    ");
+
+	while (!rc) {
+		printf("\b\b\b%03d", i-1);
+		if (!--i) {
+			printf("\nGiving up after %d DHCPv6 requests\n", retries);
+			return -1;
+		}
+		dhcpv6_state = DHCPV6_STATE_SELECT;
+		dhcpv6_send_info_request();
+		rc = dhcpv6_wait(wait);
+		if (wait < DHCPV6_MAX_WAIT)
+			wait *= 2;
+	}
+	if (rc < 0) {
+		printf("\nAborted\n");
+		return -1;
+	}
+	printf("\b\b\b\b");
+
+	memcpy(&fn_ip->own_ip6, get_ipv6_address(), sizeof(ip6_addr_t));
+	return 0;
+}
+
+/**
+ * DHCPv6: Extracts server address and file name from a boot file URL
+ *         of the form "tftp://[address]/file".
+ *
+ * @param  url   boot file URL (not terminated)
+ * @param  len   length of url
+ * @return       TRUE - URL is usable; FALSE - unsupported URL
+ */
+static int32_t
+dhcpv6_parse_url(const char *url, int len)
+{
+	char addr[40];
+	const char *end;
+	int addr_len;
+
+	if (len < 9 || strncasecmp(url, "tftp://[", 8))
+		return 0;
+	url += 8;
+	len -= 8;
+
+	end = memchr(url, ']', len);
+	if (!end)
+		return 0;
+	addr_len = end - url;
+	if (addr_len >= sizeof(addr))
+		return 0;
+	memcpy(addr, url, addr_len);
+	addr[addr_len] = 0;
+	if (!parseip6(addr, dhcpv6_fn_ip->server_ip6.addr))
+		return 0;
+
+	// skip "]/"
+	url += addr_len + 1;
+	len -= addr_len + 1;
+	if (len > 0 && *url == '/') {
+		url++;
+		len--;
+	}
+	if (len <= 0 || len >= sizeof(dhcpv6_fn_ip->filename))
+		return 0;
+
+	memcpy(dhcpv6_fn_ip->filename, url, len);
+	dhcpv6_fn_ip->filename[len] = 0;
+	return 1;
+}
+
+/**
+ * DHCPv6: Handles DHCPv6-packets according to Receive-handle diagram.
+ *
+ * @param  packet     DHCPv6-packet (without the UDP-header)
+ * @param  packetsize length of the packet
+ * @return            ZERO - packet handled successfully;
+ *                    NON ZERO - packet was not handled (e.g. bad format)
+ * @see               receive_ether
+ */
+int8_t
+handle_dhcpv6(uint8_t *packet, int32_t packetsize)
+{
+	struct dhcpv6hdr *dh = (struct dhcpv6hdr *) packet;
+	struct dhcpv6_option *opt;
+	uint8_t *ptr = (uint8_t *) (dh + 1);
+	uint8_t *end = packet + packetsize;
+	uint16_t code, len;
+
+	if (packetsize < sizeof(struct dhcpv6hdr) ||
+	    dhcpv6_state != DHCPV6_STATE_SELECT)
+		return -1;
+	if (dh->type != DHCPV6_REPLY ||
+	    memcmp(dh->transaction_id, dhcpv6_xid, 3))
+		return -1;
+
+	while (ptr + sizeof(struct dhcpv6_option) <= end) {
+		opt = (struct dhcpv6_option *) ptr;
+		code = htons(opt->code);
+		len = htons(opt->len);
+		ptr += sizeof(struct dhcpv6_option);
+		if (ptr + len > end)
+			break;
+
+		if (code == DHCPV6_OPTION_BOOT_URL) {
+			if (dhcpv6_parse_url((char *) ptr, len))
+				dhcpv6_state = DHCPV6_STATE_SUCCESS;
+			else
+				printf("\nUnsupported boot file URL\n");
+			return 0;
+		}
+		ptr += len;
+	}
+
+	// a Reply without a boot file URL - wait for another server
+	return -1;
+}
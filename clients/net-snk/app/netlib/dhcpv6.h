@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+#ifndef _DHCPV6_H_
+#define _DHCPV6_H_
+
+#include <stdint.h>
+#include <netlib/tftp.h>
+
+/* Modes of do_dhcpv6 (only the stateless one is implemented) */
+#define DHCPV6_STATELESS               0
+#define DHCPV6_STATEFUL                1
+
+/* DHCPv6 message types (RFC 3315) */
+#define DHCPV6_REPLY                   7
+#define DHCPV6_INFORMATION_REQUEST    11
+
+/* DHCPv6 option codes */
+#define DHCPV6_OPTION_CLIENTID         1
+#define DHCPV6_OPTION_SERVERID         2
+#define DHCPV6_OPTION_ORO              6
+#define DHCPV6_OPTION_ELAPSED_TIME     8
+#define DHCPV6_OPTION_STATUS_CODE     13
+#define DHCPV6_OPTION_BOOT_URL        59   /**< RFC 5970 */
+
+/* DUID based on the link-layer address */
+#define DHCPV6_DUID_LL                 3
+#define DHCPV6_HWTYPE_ETHERNET         1
+
+/** \struct dhcpv6hdr
+ *  A header for DHCPv6-messages, followed by the options.
+ */
+struct dhcpv6hdr {
+	uint8_t type;
+	uint8_t transaction_id[3];
+} __attribute__ ((packed));
+
+/** \struct dhcpv6_option
+ *  A DHCPv6 option header, followed by len bytes of data.
+ */
+struct dhcpv6_option {
+	uint16_t code;
+	uint16_t len;
+} __attribute__ ((packed));
+
+int do_dhcpv6(char *ret_buffer, filename_ip_t *fn_ip, unsigned int retries,
+              uint8_t mode);
+
+/* Handles DHCPv6-packets, which are detected by receive_ether. */
+extern int8_t handle_dhcpv6(uint8_t *packet, int32_t packetsize);
+
+#endif
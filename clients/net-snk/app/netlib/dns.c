@@ -10,12 +10,35 @@
  *     IBM Corporation - initial implementation
  *****************************************************************************/
 
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> ALGORITHMS <<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/** \file dns.c <pre>
+ * ************************** DNS resolver ********************************
+ *
+ * A query is sent to all known DNS servers at once (up to DNS_SERVERS,
+ * usually taken from the DHCP option 6). Every server gets its own query
+ * ID, so the answers can be told apart: the first positive answer wins,
+ * a server returning an error is not asked again, and NXDOMAIN ends the
+ * lookup. The queries are repeated for DNS_ROUNDS rounds, waiting
+ * DNS_INITIAL_WAIT ms for the first round and doubling the wait up to
+ * DNS_MAX_WAIT ms. A query that send_ipv4 drops while it resolves the MAC
+ * address of the server or router is sent again every DNS_RESEND_MSECS ms
+ * from the timer hook of the receive loop.
+ *
+ * Resolved addresses are kept in a small cache until their TTL expires,
+ * so several lookups of the same host (e.g. for the boot file and the
+ * configuration files) only cost one DNS exchange.
+ *
+ * ************************************************************************
+ * </pre> */
+
 /*>>>>>>>>>>>>>>>>>>>>> DEFINITIONS & DECLARATIONS <<<<<<<<<<<<<<<<<<<<<<*/
 
 #include <dns.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <kernel.h>
 #include <sys/socket.h>
 
 #include <ethernet.h>
@@ -29,12 +52,20 @@
 #define DNS_FLAG_RCODE      0x000F	/**< Response code mask
                                          (stores err.cond.) code    */
 #define DNS_RCODE_NERROR    0       /**< "No errors" code           */
+#define DNS_RCODE_NXDOMAIN  3       /**< "Name does not exist" code */
 
 #define DNS_QTYPE_A         1       /**< A 32-bit IP record type */
 #define DNS_QTYPE_CNAME     5       /**< Canonical name record type */
 
 #define DNS_QCLASS_IN       1       /**< Query class for internet msgs */
 
+#define DNS_QUERY_ID        0x1234  /**< ID of the query to the 1st server */
+#define DNS_ROUNDS          8       /**< Queries sent to every server */
+#define DNS_INITIAL_WAIT    1000    /**< ms to wait for the first answer */
+#define DNS_MAX_WAIT        4000    /**< ms to wait at most per round */
+#define DNS_RESEND_MSECS    100     /**< ms until a dropped query is resent */
+#define DNS_CACHE_ENTRIES   4       /**< Resolved names kept in cache */
+
 /** \struct dnshdr
  *  A header for DNS-messages (see RFC 1035, paragraph 4.1.1).
  *  <p>
@@ -60,14 +91,26 @@ struct dnshdr {
 	                         additional section */
 };
 
+/** \struct dns_cache_entry
+ *  A resolved domain name, valid until the time base reaches expires.
+ */
+struct dns_cache_entry {
+	int8_t   name[0x100];   /**< domain name as series of labels */
+	uint32_t ip;            /**< IPv4 address of the name */
+	uint64_t expires;       /**< end of the TTL in time base ticks */
+};
+
 
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>> PROTOTYPES <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
+static int
+dns_send_query(int8_t * domain_name, int server);
+
 static void
-dns_send_query(int8_t * domain_name);
+dns_resend(void);
 
 static void
-fill_dnshdr(uint8_t * packet, int8_t * domain_name);
+fill_dnshdr(uint8_t * packet, int8_t * domain_name, uint16_t id);
 
 static uint8_t *
 dns_extract_name(uint8_t * dnsh, int8_t * head, int8_t * domain_name);
@@ -78,14 +121,31 @@ urltohost(char * url, char * host_name);
 static int8_t
 hosttodomain(char * host_name, char * domain_name);
 
+static int32_t
+dns_done(void);
+
+static int8_t
+dns_cache_lookup(int8_t * domain_name, uint32_t * domain_ip);
+
+static void
+dns_cache_store(int8_t * domain_name, uint32_t domain_ip, uint32_t ttl);
+
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 static uint8_t ether_packet[ETH_MTU_SIZE];
-static int32_t dns_server_ip     = 0;
+static uint32_t dns_servers[DNS_SERVERS];
+static int32_t dns_server_count  = 0;
+static uint32_t dns_failed       = 0;        /**< Servers answering error */
+static uint32_t dns_unsent       = 0;        /**< Queries dropped by ARP */
+static int8_t * dns_query_name   = NULL;     /**< Name asked in this round */
+static uint16_t dns_query_id     = DNS_QUERY_ID; /**< ID for 1st server  */
 static int32_t dns_result_ip     = 0;
+static uint32_t dns_result_ttl   = 0;
 static int8_t  dns_error         = 0;        /**< Stores error code or 0 */
 static int8_t  dns_domain_name[0x100];       /**< Raw domain name        */
 static int8_t  dns_domain_cname[0x100];      /**< Canonical domain name  */
+static struct dns_cache_entry dns_cache[DNS_CACHE_ENTRIES];
+static int32_t dns_cache_next    = 0;        /**< Entry to replace next  */
 
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>> IMPLEMENTATION <<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
@@ -97,14 +157,89 @@ static int8_t  dns_domain_cname[0x100];      /**< Canonical domain name  */
  * @param  server_ip     DNS-server IPv4 address (e.g. 127.0.0.1)
  * @return               TRUE in case of successful initialization;
  *                       FALSE in case of fault (e.g. can't obtain MAC).
+ * @see                  dns_add_server
  * @see                  dns_get_ip
  */
 int8_t
 dns_init(uint32_t _dns_server_ip) {
-	dns_server_ip = _dns_server_ip;
+	dns_server_count = 0;
+	dns_add_server(_dns_server_ip);
 	return 0;
 }
 
+/**
+ * DNS: Adds another DNS-server, which is queried in parallel with the
+ *      ones already known. Servers beyond DNS_SERVERS are ignored.
+ *
+ * @param  server_ip     DNS-server IPv4 address
+ * @see                  dns_init
+ */
+void
+dns_add_server(uint32_t server_ip) {
+	int i;
+
+	if (server_ip == 0 || dns_server_count >= DNS_SERVERS)
+		return;
+	for (i = 0; i < dns_server_count; ++i)
+		if (dns_servers[i] == server_ip)
+			return;
+	dns_servers[dns_server_count++] = server_ip;
+}
+
+/**
+ * DNS: Tells net_poll whether the query has been answered.
+ *
+ * @return  NON ZERO - answer or error received; ZERO - still waiting
+ */
+static int32_t
+dns_done(void) {
+	return dns_error || dns_result_ip;
+}
+
+/**
+ * DNS: Looks for a domain name whose TTL has not expired yet in the cache.
+ *
+ * @param  domain_name the domain name given as series of labels
+ * @param  domain_ip   In case of SUCCESS stores the cached IP.
+ * @return             TRUE - name found in cache; FALSE - not cached
+ */
+static int8_t
+dns_cache_lookup(int8_t * domain_name, uint32_t * domain_ip) {
+	uint64_t now = get_time();
+	int i;
+
+	for (i = 0; i < DNS_CACHE_ENTRIES; ++i) {
+		if (dns_cache[i].ip == 0 || now >= dns_cache[i].expires)
+			continue;
+		if (!strcmp((char *) dns_cache[i].name, (char *) domain_name)) {
+			(* domain_ip) = dns_cache[i].ip;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * DNS: Stores a resolved domain name in the cache, replacing the oldest
+ *      entry. Answers with TTL 0 must not be cached (RFC 1035, 3.2.1).
+ *
+ * @param  domain_name the domain name given as series of labels
+ * @param  domain_ip   resolved IPv4 address
+ * @param  ttl         time to live of the answer in seconds
+ */
+static void
+dns_cache_store(int8_t * domain_name, uint32_t domain_ip, uint32_t ttl) {
+	struct dns_cache_entry * entry = &dns_cache[dns_cache_next];
+
+	if (ttl == 0)
+		return;
+
+	strcpy((char *) entry->name, (char *) domain_name);
+	entry->ip = domain_ip;
+	entry->expires = get_time() + (uint64_t) ttl * TICKS_SEC;
+	dns_cache_next = (dns_cache_next + 1) % DNS_CACHE_ENTRIES;
+}
+
 /**
  * DNS: For given URL retrieves IPv4 from DNS-server.
  *      <p>
@@ -125,8 +260,12 @@ dns_init(uint32_t _dns_server_ip) {
  */
 int8_t
 dns_get_ip(int8_t * url, uint32_t * domain_ip) {
-	/* this counter is used so that we abort after 30 DNS request */
+	/* this counter is used so that we abort after DNS_ROUNDS rounds */
 	int32_t i;
+	int32_t server;
+	int32_t answered;
+	int32_t wait = DNS_INITIAL_WAIT;
+	int8_t * name;
 	/* this buffer stores host name retrieved from url */
 	static int8_t host_name[0x100];
 
@@ -144,8 +283,12 @@ dns_get_ip(int8_t * url, uint32_t * domain_ip) {
 		return 0;
 	}
 
+	// A name resolved recently needs no DNS-server
+	if (dns_cache_lookup(dns_domain_name, domain_ip))
+		return 1;
+
 	// Check if DNS server is presented and accessible
-	if (dns_server_ip == 0) {
+	if (dns_server_count == 0) {
 		printf("\nERROR:\t\t\tCan't resolve domain name "
 		       "(DNS server is not presented)!\n");
 		return 0;
@@ -154,26 +297,43 @@ dns_get_ip(int8_t * url, uint32_t * domain_ip) {
 	// Use DNS-server to obtain IP
 	dns_result_ip = 0;
 	dns_error     = 0;
+	dns_failed    = 0;
 	strcpy((char *) dns_domain_cname, "");
+	// new IDs, so late answers to a previous lookup are ignored
+	dns_query_id += DNS_SERVERS;
 
-	for(i = 0; i < 30; ++i) {
+	for(i = 0; i < DNS_ROUNDS; ++i) {
 		// Use canonical name in case we obtained it
 		if (strlen((char *) dns_domain_cname))
-		  dns_send_query(dns_domain_cname);
+			name = dns_domain_cname;
 		else
-		  dns_send_query(dns_domain_name);
-
-		// setting up a timer with a timeout of one seconds
-		set_timer(TICKS_SEC);
-		do {
-			receive_ether();
+			name = dns_domain_name;
+
+		// ask all servers which did not report an error; queries
+		// dropped while ARP is pending are resent by dns_resend
+		dns_query_name = name;
+		dns_unsent = 0;
+		for (server = 0; server < dns_server_count; ++server)
+			if (!(dns_failed & (1 << server))
+			    && dns_send_query(name, server) == -2)
+				dns_unsent |= 1 << server;
+		if (dns_unsent)
+			net_set_timer(dns_resend, DNS_RESEND_MSECS);
+
+		// the first answer of any server wins
+		answered = net_poll(wait, dns_done);
+		net_clear_timer(dns_resend);
+		if (answered) {
 			if (dns_error)
 				return 0; // FALSE - error
-			if (dns_result_ip != 0) {
-				(* domain_ip) = dns_result_ip;
-				return 1; // TRUE - success (domain IP retrieved)
-			}
-		} while (get_timer() > 0);
+			(* domain_ip) = dns_result_ip;
+			dns_cache_store(dns_domain_name, dns_result_ip,
+			                dns_result_ttl);
+			return 1; // TRUE - success (domain IP retrieved)
+		}
+
+		if (wait < DNS_MAX_WAIT)
+			wait *= 2;
 	}
 
 	printf("\nGiving up after %d DNS requests\n", i);
@@ -200,10 +360,12 @@ handle_dns(uint8_t * packet, int32_t packetsize) {
 	uint8_t * resp_section = packet + sizeof(struct dnshdr);
 	/* This string stores domain name from DNS-packets */
 	static int8_t handle_domain_name[0x100]; 
+	uint16_t server;
 	int i;
 
-	// verify ID - is it response for our query?
-	if (dnsh -> id != htons(0x1234))
+	// verify ID - is it response for our query? (also tells the server)
+	server = htons(dnsh -> id) - dns_query_id;
+	if (server >= dns_server_count)
 		return 0;
 
 	// Is it DNS response?
@@ -211,9 +373,19 @@ handle_dns(uint8_t * packet, int32_t packetsize) {
 		return 0;
 
 	// Is error condition occurs? (check error field in incoming packet)
-	if ((dnsh -> flags & htons(DNS_FLAG_RCODE)) != DNS_RCODE_NERROR) {
+	switch (htons(dnsh -> flags & htons(DNS_FLAG_RCODE))) {
+	case DNS_RCODE_NERROR:
+		break;
+	case DNS_RCODE_NXDOMAIN:
+		// the name does not exist - no need to ask other servers
 		dns_error = 1;
 		return 0;
+	default:
+		// server failure etc. - rely on the remaining servers
+		dns_failed |= 1 << server;
+		if (dns_failed == (1U << dns_server_count) - 1)
+			dns_error = 1;
+		return 0;
 	}
 
 	/*        Pass all (qdcount) records in question section         */
@@ -248,7 +420,8 @@ handle_dns(uint8_t * packet, int32_t packetsize) {
 				switch (htons(* (uint16_t *) resp_section)) {
 
 				case DNS_QTYPE_A :
-					// rdata contains IP
+					// rdata contains IP, the TTL precedes it
+					dns_result_ttl = htonl(* (uint32_t *) (resp_section + 4));
 					dns_result_ip = htonl(* (uint32_t *) (resp_section + 10));
 					return 0; // IP successfully obtained
 
@@ -262,9 +435,9 @@ handle_dns(uint8_t * packet, int32_t packetsize) {
 					break;
 				}
 			}
-			// continue with next record in answer section
-			resp_section += htons(* (uint16_t *) (resp_section + 8)) + 10;
 		}
+		// continue with next record in answer section
+		resp_section += htons(* (uint16_t *) (resp_section + 8)) + 10;
 	}
 	return 0; // Packet successfully handled but IP wasn't obtained
 }
@@ -277,10 +450,14 @@ handle_dns(uint8_t * packet, int32_t packetsize) {
  * @param  domain_name the domain name given as series of labels preceded
  *                     with length(label) and terminated with 0  
  *                     <br>(e.g. "\3,w,w,w,\4,h,o,s,t,\3,o,r,g,\0")
+ * @param  server      index of the DNS-server (see dns_add_server)
+ * @return             -2 - the query was dropped since ARP is pending;
+ *                     otherwise the result of send_ipv4
  * @see                handle_dns
+ * @see                dns_resend
  */
-static void
-dns_send_query(int8_t * domain_name) {
+static int
+dns_send_query(int8_t * domain_name, int server) {
 	int qry_len = strlen((char *) domain_name) + 5;
 
 	uint32_t packetsize = sizeof(struct iphdr) +
@@ -290,7 +467,7 @@ dns_send_query(int8_t * domain_name) {
 	memset(ether_packet, 0, packetsize);
 	fill_dnshdr(&ether_packet[
 	            sizeof(struct iphdr) + sizeof(struct udphdr)],
-	            domain_name);
+	            domain_name, dns_query_id + server);
 	fill_udphdr(&ether_packet[
 	            sizeof(struct iphdr)], sizeof(struct dnshdr) +
 	            sizeof(struct udphdr) + qry_len,
@@ -298,9 +475,33 @@ dns_send_query(int8_t * domain_name) {
 	fill_iphdr(ether_packet,
 	           sizeof(struct dnshdr) + sizeof(struct udphdr) +
 	           sizeof(struct iphdr) + qry_len,
-	           IPTYPE_UDP, 0, dns_server_ip);
+	           IPTYPE_UDP, 0, dns_servers[server]);
+
+	return send_ipv4(ether_packet, packetsize);
+}
 
-	send_ipv4(ether_packet, packetsize);
+/**
+ * DNS: Timer callback, sends the queries of the current round again
+ *      which send_ipv4 dropped because an ARP request was pending
+ *      (several servers behind the same router share one ARP entry).
+ *      Rearms itself until all of them are sent.
+ *
+ * @see                dns_send_query
+ * @see                net_set_timer
+ */
+static void
+dns_resend(void) {
+	int server;
+
+	for (server = 0; server < dns_server_count; ++server) {
+		if (!(dns_unsent & (1 << server)))
+			continue;
+		if ((dns_failed & (1 << server))
+		    || dns_send_query(dns_query_name, server) != -2)
+			dns_unsent &= ~(1 << server);
+	}
+	if (dns_unsent)
+		net_set_timer(dns_resend, DNS_RESEND_MSECS);
 }
 
 /**
@@ -315,16 +516,17 @@ dns_send_query(int8_t * domain_name) {
  * @param  domain_name the domain name given as series of labels preceded
  *                     with length(label) and terminated with 0  
  *                     <br>(e.g. "\3,w,w,w,\4,h,o,s,t,\3,o,r,g,\0")
+ * @param  id          query ID, identifies the DNS-server in the answer
  * @see                fill_udphdr
  * @see                fill_iphdr
  * @see                fill_ethhdr
  */
 static void
-fill_dnshdr(uint8_t * packet, int8_t * domain_name) {
+fill_dnshdr(uint8_t * packet, int8_t * domain_name, uint16_t id) {
 	struct dnshdr * dnsh = (struct dnshdr *) packet;
 	uint8_t * qry_section = packet + sizeof(struct dnshdr);
 
-	dnsh -> id = htons(0x1234);
+	dnsh -> id = htons(id);
 	dnsh -> flags = htons(DNS_FLAG_SQUERY) | htons(DNS_FLAG_RD);
 	dnsh -> qdcount = htons(1);
 
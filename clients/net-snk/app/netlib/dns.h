@@ -16,9 +16,15 @@
 
 #include <stdint.h>
 
+/* Maximum number of DNS-servers queried in parallel */
+#define DNS_SERVERS 3
+
 /* Initialize the environment for DNS client. */
 extern int8_t dns_init(uint32_t dns_server_ip);
 
+/* Adds another DNS-server to the ones given to dns_init. */
+extern void dns_add_server(uint32_t dns_server_ip);
+
 /* For given URL retrieves IPv4 from DNS-server. */
 extern int8_t dns_get_ip(int8_t * domain_name, uint32_t * domain_ip);
 
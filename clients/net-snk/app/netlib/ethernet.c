@@ -38,6 +38,14 @@
  * upper               DNS (handle_dns)      BootP / DHCP (handle_bootp_client)
  * 
  * ************************************************************************
+ *
+ * The protocols wait for their answers with net_poll(), which receives
+ * packets until the protocol is done or a timeout expires. Frames that are
+ * not addressed to us are dropped before anything else is done with them.
+ * Timer callbacks (net_set_timer) are run from receive_ether, so they also
+ * fire while a protocol polls on its own (e.g. TFTP).
+ *
+ * ************************************************************************
  * </pre> */
 
 
@@ -47,7 +55,15 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <ipv4.h>
-//#include <ipv6.h>
+#include <ipv6.h>
+#include <kernel.h>
+#include <time.h>
+
+/* Number of timer callbacks of the receive loop */
+#define NET_TIMERS 4
+
+static void
+net_run_timers(void);
 
 
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<*/
@@ -57,6 +73,11 @@ static uint8_t own_mac[6] = {0, 0, 0, 0, 0, 0};
 static uint8_t multicast_mac[] = {0x01, 0x00, 0x5E};
 static const uint8_t broadcast_mac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
+static struct {
+	void   (*fn)(void);
+	uint64_t expires;        /**< timebase value */
+} net_timers[NET_TIMERS];
+
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> IMPLEMENTATION <<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 /**
@@ -111,10 +132,11 @@ receive_ether(void) {
 	int32_t bytes_received;
 	struct ethhdr * ethh;
 
-	memset(ether_packet, 0, ETH_MTU_SIZE);
+	net_run_timers();
+
 	bytes_received = recv(0, ether_packet, ETH_MTU_SIZE, 0);
 
-	if (!bytes_received) // No messages
+	if (bytes_received <= 0) // No messages
 		return 0;
 
 	if (bytes_received < sizeof(struct ethhdr))
@@ -126,17 +148,19 @@ receive_ether(void) {
 	&& memcmp(ethh->dest_mac, multicast_mac, 3) != 0
 	&& memcmp(ethh->dest_mac, own_mac, 6      ) != 0
 	&& !is_multicast_mac(ethh->dest_mac))
-		return -1; // packet is too small
+		return -1; // not for us
+
+	/* The upper layers expect the unused rest of the buffer to be
+	 * cleared; this is done for the accepted frames only */
+	memset(ether_packet + bytes_received, 0, ETH_MTU_SIZE - bytes_received);
 
 	switch (htons(ethh -> type)) {
 	case ETHERTYPE_IP:
 		return handle_ipv4((uint8_t*) (ethh + 1),
 		                   bytes_received - sizeof(struct ethhdr));
-/*
 	case ETHERTYPE_IPv6:
 		return handle_ipv6(ether_packet + sizeof(struct ethhdr),
 				bytes_received - sizeof(struct ethhdr));
-*/
 	case ETHERTYPE_ARP:
 		return handle_arp((uint8_t*) (ethh + 1),
 		           bytes_received - sizeof(struct ethhdr));
@@ -146,6 +170,96 @@ receive_ether(void) {
 	return -1; // unknown protocol
 }
 
+/**
+ * Ethernet: Receives and handles packets until done() reports that the
+ *           caller has got what it is waiting for, or the timeout expires.
+ *
+ * @param  msecs  timeout in milliseconds
+ * @param  done   returns NON ZERO if the wait is over (may be NULL)
+ * @return        value of done() or ZERO on timeout
+ */
+int32_t
+net_poll(int32_t msecs, int32_t (*done)(void))
+{
+	uint64_t timeout = get_time() + (uint64_t) msecs * TICKS_MSEC;
+	int32_t rc;
+
+	do {
+		receive_ether();
+		if (done && (rc = done()) != 0)
+			return rc;
+	} while (get_time() < timeout);
+
+	return 0;
+}
+
+/**
+ * Ethernet: Arms a timer callback of the receive loop. A callback that
+ *           is armed already gets the new timeout.
+ *
+ * @param  fn     function to call once the timeout expires
+ * @param  msecs  timeout in milliseconds
+ * @return        ZERO - timer set; NON ZERO - no free timer
+ */
+int
+net_set_timer(void (*fn)(void), int32_t msecs)
+{
+	uint64_t expires = get_time() + (uint64_t) msecs * TICKS_MSEC;
+	int i, free = -1;
+
+	for (i = 0; i < NET_TIMERS; i++) {
+		if (net_timers[i].fn == fn)
+			break;
+		if (!net_timers[i].fn && free < 0)
+			free = i;
+	}
+	if (i == NET_TIMERS) {
+		if (free < 0)
+			return -1;
+		i = free;
+	}
+
+	net_timers[i].fn = fn;
+	net_timers[i].expires = expires;
+	return 0;
+}
+
+/**
+ * Ethernet: Disarms a timer callback of the receive loop.
+ *
+ * @param  fn     function that was given to net_set_timer
+ */
+void
+net_clear_timer(void (*fn)(void))
+{
+	int i;
+
+	for (i = 0; i < NET_TIMERS; i++) {
+		if (net_timers[i].fn == fn)
+			net_timers[i].fn = NULL;
+	}
+}
+
+/**
+ * Ethernet: Runs the timer callbacks whose timeout has expired. Each timer
+ *           fires once; the callback may arm it again.
+ */
+static void
+net_run_timers(void)
+{
+	uint64_t now = get_time();
+	void (*fn)(void);
+	int i;
+
+	for (i = 0; i < NET_TIMERS; i++) {
+		if (net_timers[i].fn && now >= net_timers[i].expires) {
+			fn = net_timers[i].fn;
+			net_timers[i].fn = NULL;
+			fn();
+		}
+	}
+}
+
 /**
  * Ethernet: Sends an ethernet frame via the initialized file descriptor.
  *
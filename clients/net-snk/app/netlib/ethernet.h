@@ -37,6 +37,14 @@ extern const uint8_t * get_mac_address(void);
 /* Receives and handles packets, according to Receive-handle diagram */
 extern int32_t receive_ether(void);
 
+/* Receives and handles packets until done() returns NON ZERO or the
+ * timeout expires */
+extern int32_t net_poll(int32_t msecs, int32_t (*done)(void));
+
+/* Timer callbacks of the receive loop (one-shot) */
+extern int  net_set_timer(void (*fn)(void), int32_t msecs);
+extern void net_clear_timer(void (*fn)(void));
+
 /* Sends an ethernet frame. */
 extern int send_ether(void* buffer, int len);
 
@@ -0,0 +1,336 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*>>>>>>>>>>>>>>>>>>>>> DEFINITIONS & DECLARATIONS <<<<<<<<<<<<<<<<<<<<<<*/
+
+#include <icmpv6.h>
+#include <ipv6.h>
+#include <ipv4.h>
+#include <ndp.h>
+#include <udp.h>
+#include <ethernet.h>
+#include <sys/socket.h>
+#include <string.h>
+
+/* Neighbor discovery messages are only accepted from the local link */
+#define ND_HOP_LIMIT         255
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> PROTOTYPES <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+static void
+send_neighbour_advertisement(ip6_addr_t *dest, ip6_addr_t *target);
+
+static struct nd_option *
+find_nd_option(uint8_t *options, int32_t len, uint8_t type);
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+static uint8_t icmp6_packet[ETH_MTU_SIZE];
+
+/* ff02::2 */
+static ip6_addr_t all_routers = { .addr = { 0xff, 0x02, 0, 0, 0, 0, 0, 0,
+                                             0, 0, 0, 0, 0, 0, 0, 2 } };
+/* ff02::1 */
+static ip6_addr_t all_nodes = { .addr = { 0xff, 0x02, 0, 0, 0, 0, 0, 0,
+                                           0, 0, 0, 0, 0, 0, 0, 1 } };
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>> IMPLEMENTATION <<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/**
+ * ICMPv6: Appends a link-layer address option with our MAC address.
+ *
+ * @param  opt    place of the option in the packet
+ * @param  type   ND_OPT_SOURCE_LL_ADDR or ND_OPT_TARGET_LL_ADDR
+ * @return        size of the option
+ */
+static int
+fill_ll_option(uint8_t *opt, uint8_t type)
+{
+	struct nd_option *o = (struct nd_option *) opt;
+
+	o->type = type;
+	o->len = 1;
+	memcpy(o->data, get_mac_address(), 6);
+	return sizeof(struct nd_option);
+}
+
+/**
+ * ICMPv6: Sends a Router Solicitation. The answer (a Router Advertisement)
+ *         tells us the prefix for the stateless address autoconfiguration
+ *         and the default router.
+ */
+void
+send_router_solicitation(void)
+{
+	struct ip6hdr *ip6h = (struct ip6hdr *) icmp6_packet;
+	struct icmp6hdr *icmp6h = (struct icmp6hdr *) (ip6h + 1);
+	int len = sizeof(struct icmp6hdr);
+
+	memset(icmp6_packet, 0, sizeof(struct ip6hdr) + len +
+	       sizeof(struct nd_option));
+	icmp6h->type = ICMPV6_ROUTER_SOLICITATION;
+	len += fill_ll_option((uint8_t *) icmp6h + len, ND_OPT_SOURCE_LL_ADDR);
+
+	fill_ip6hdr(icmp6_packet, len, IPTYPE_ICMPV6, get_ipv6_link_local(),
+	            &all_routers);
+	send_ipv6(icmp6_packet, sizeof(struct ip6hdr) + len);
+}
+
+/**
+ * ICMPv6: Sends a Neighbor Solicitation to the solicited-node multicast
+ *         address of the target (RFC 4861 7.2.2).
+ *
+ * @param  target   IPv6 address whose MAC address is wanted
+ */
+void
+send_neighbour_solicitation(ip6_addr_t *target)
+{
+	struct ip6hdr *ip6h = (struct ip6hdr *) icmp6_packet;
+	struct icmp6hdr *icmp6h = (struct icmp6hdr *) (ip6h + 1);
+	ip6_addr_t dest;
+	int len = sizeof(struct icmp6hdr);
+
+	// ff02::1:ffXX:XXXX with the last 24 bits of the target
+	memset(&dest, 0, sizeof(dest));
+	dest.addr[0] = 0xff;
+	dest.addr[1] = 0x02;
+	dest.addr[11] = 0x01;
+	dest.addr[12] = 0xff;
+	memcpy(&dest.addr[13], &target->addr[13], 3);
+
+	memset(icmp6_packet, 0, sizeof(struct ip6hdr) + len +
+	       sizeof(ip6_addr_t) + sizeof(struct nd_option));
+	icmp6h->type = ICMPV6_NEIGHBOUR_SOLICITATION;
+	memcpy((uint8_t *) icmp6h + len, target, sizeof(ip6_addr_t));
+	len += sizeof(ip6_addr_t);
+	len += fill_ll_option((uint8_t *) icmp6h + len, ND_OPT_SOURCE_LL_ADDR);
+
+	fill_ip6hdr(icmp6_packet, len, IPTYPE_ICMPV6, NULL, &dest);
+	send_ipv6(icmp6_packet, sizeof(struct ip6hdr) + len);
+}
+
+/**
+ * ICMPv6: Answers a Neighbor Solicitation for one of our addresses.
+ *
+ * @param  dest     sender of the solicitation (or all-nodes)
+ * @param  target   our address, which was asked for
+ */
+static void
+send_neighbour_advertisement(ip6_addr_t *dest, ip6_addr_t *target)
+{
+	struct ip6hdr *ip6h = (struct ip6hdr *) icmp6_packet;
+	struct icmp6hdr *icmp6h = (struct icmp6hdr *) (ip6h + 1);
+	int len = sizeof(struct icmp6hdr);
+
+	memset(icmp6_packet, 0, sizeof(struct ip6hdr) + len +
+	       sizeof(ip6_addr_t) + sizeof(struct nd_option));
+	icmp6h->type = ICMPV6_NEIGHBOUR_ADVERTISEMENT;
+	icmp6h->data = htonl(ND_NA_OVERRIDE);
+	if (dest != &all_nodes)
+		icmp6h->data |= htonl(ND_NA_SOLICITED);
+	memcpy((uint8_t *) icmp6h + len, target, sizeof(ip6_addr_t));
+	len += sizeof(ip6_addr_t);
+	len += fill_ll_option((uint8_t *) icmp6h + len, ND_OPT_TARGET_LL_ADDR);
+
+	fill_ip6hdr(icmp6_packet, len, IPTYPE_ICMPV6, target, dest);
+	send_ipv6(icmp6_packet, sizeof(struct ip6hdr) + len);
+}
+
+/**
+ * ICMPv6: Answers an Echo Request with the same data.
+ */
+static void
+send_echo_reply(struct ip6hdr *ip6h, uint8_t *packet, int32_t packetsize)
+{
+	struct ip6hdr *reply = (struct ip6hdr *) icmp6_packet;
+	struct icmp6hdr *icmp6h = (struct icmp6hdr *) (reply + 1);
+	ip6_addr_t src, dst;
+
+	if (packetsize > ETH_MTU_SIZE - sizeof(struct ethhdr) -
+	    sizeof(struct ip6hdr))
+		return;
+
+	// the header is packed, so work on aligned copies of the addresses
+	memcpy(&src, &ip6h->src, sizeof(ip6_addr_t));
+	memcpy(&dst, &ip6h->dst, sizeof(ip6_addr_t));
+
+	memcpy(icmp6h, packet, packetsize);
+	icmp6h->type = ICMPV6_ECHO_REPLY;
+	icmp6h->checksum = 0;
+
+	fill_ip6hdr(icmp6_packet, packetsize, IPTYPE_ICMPV6,
+	            ip6_is_multicast(&dst) ? NULL : &dst, &src);
+	send_ipv6(icmp6_packet, sizeof(struct ip6hdr) + packetsize);
+}
+
+/**
+ * ICMPv6: Finds a neighbor discovery option.
+ *
+ * @param  options  first option of the message
+ * @param  len      size of all options
+ * @param  type     option to look for
+ * @return          the option or NULL if it is not present
+ */
+static struct nd_option *
+find_nd_option(uint8_t *options, int32_t len, uint8_t type)
+{
+	struct nd_option *opt;
+
+	while (len >= sizeof(struct nd_option)) {
+		opt = (struct nd_option *) options;
+		if (!opt->len || opt->len * 8 > len)
+			break;
+		if (opt->type == type)
+			return opt;
+		options += opt->len * 8;
+		len -= opt->len * 8;
+	}
+	return NULL;
+}
+
+/**
+ * ICMPv6: Handles a Router Advertisement: the router becomes the default
+ *         router and autonomous prefixes are used for the stateless
+ *         address autoconfiguration (RFC 4862).
+ */
+static void
+handle_ra(struct ip6hdr *ip6h, uint8_t *packet, int32_t packetsize)
+{
+	/* 4 bytes reachable time and 4 bytes retrans timer follow the header */
+	uint8_t *options = packet + sizeof(struct icmp6hdr) + 8;
+	int32_t len = packetsize - sizeof(struct icmp6hdr) - 8;
+	struct nd_option *opt;
+	struct nd_prefix_info *pi;
+	uint16_t router_lifetime = *(uint16_t *) (packet + 6);
+	ip6_addr_t src, prefix;
+
+	memcpy(&src, &ip6h->src, sizeof(ip6_addr_t));
+	if (len < 0 || !ip6_is_linklocal(&src))
+		return;
+
+	opt = find_nd_option(options, len, ND_OPT_SOURCE_LL_ADDR);
+	if (opt)
+		update_neighbor(&src, opt->data);
+	if (router_lifetime)
+		ipv6_set_router(&src, opt ? opt->data : NULL);
+
+	// there can be several prefixes
+	while (len >= sizeof(struct nd_prefix_info)) {
+		opt = find_nd_option(options, len, ND_OPT_PREFIX_INFORMATION);
+		if (!opt)
+			break;
+		pi = (struct nd_prefix_info *) opt;
+		memcpy(&prefix, &pi->prefix, sizeof(ip6_addr_t));
+		if (pi->len == 4 && (pi->flags & ND_PREFIX_AUTONOMOUS) &&
+		    pi->prefix_length == 64 && pi->valid_lifetime &&
+		    !ip6_is_linklocal(&prefix))
+			ipv6_set_prefix(&prefix, pi->prefix_length);
+		len -= (uint8_t *) opt - options + opt->len * 8;
+		options = (uint8_t *) opt + opt->len * 8;
+	}
+}
+
+/**
+ * ICMPv6: Handles ICMPv6-packets according to Receive-handle diagram.
+ *
+ * @param  ip6h       IPv6 header of the packet
+ * @param  packet     ICMPv6 message to be handled
+ * @param  packetsize length of the message
+ * @return            ZERO - packet handled successfully;
+ *                    NON ZERO - packet was not handled (e.g. bad format)
+ */
+int8_t
+handle_icmpv6(struct ip6hdr *ip6h, uint8_t *packet, int32_t packetsize)
+{
+	struct icmp6hdr *icmp6h = (struct icmp6hdr *) packet;
+	ip6_addr_t *target = (ip6_addr_t *) (icmp6h + 1);
+	int32_t optlen = packetsize - sizeof(struct icmp6hdr) -
+	                 sizeof(ip6_addr_t);
+	struct nd_option *opt;
+	struct ip6hdr *orig;
+	uint8_t err_code;
+	ip6_addr_t src;
+
+	if (packetsize < sizeof(struct icmp6hdr))
+		return -1;
+
+	memcpy(&src, &ip6h->src, sizeof(ip6_addr_t));
+
+	if (ip6_checksum(ip6h, packet, packetsize))
+		return -1; // Wrong ICMPv6 checksum
+
+	switch (icmp6h->type) {
+	case ICMPV6_ECHO_REQUEST:
+		send_echo_reply(ip6h, packet, packetsize);
+		break;
+
+	case ICMPV6_ROUTER_ADVERTISEMENT:
+		if (ip6h->hl != ND_HOP_LIMIT)
+			return -1;
+		handle_ra(ip6h, packet, packetsize);
+		break;
+
+	case ICMPV6_NEIGHBOUR_SOLICITATION:
+		if (ip6h->hl != ND_HOP_LIMIT || optlen < 0)
+			return -1;
+		if (!ipv6_is_own(target))
+			break;
+		// duplicate address detection of another node
+		if (!ip6h->src.part[0] && !ip6h->src.part[1]) {
+			send_neighbour_advertisement(&all_nodes, target);
+			break;
+		}
+		opt = find_nd_option((uint8_t *) (target + 1), optlen,
+		                     ND_OPT_SOURCE_LL_ADDR);
+		if (opt)
+			update_neighbor(&src, opt->data);
+		send_neighbour_advertisement(&src, target);
+		break;
+
+	case ICMPV6_NEIGHBOUR_ADVERTISEMENT:
+		if (ip6h->hl != ND_HOP_LIMIT || optlen < 0)
+			return -1;
+		opt = find_nd_option((uint8_t *) (target + 1), optlen,
+		                     ND_OPT_TARGET_LL_ADDR);
+		if (opt && find_neighbor(target))
+			update_neighbor(target, opt->data);
+		break;
+
+	case ICMPV6_DEST_UNREACHABLE:
+		// the message contains the start of the packet that failed
+		orig = (struct ip6hdr *) (icmp6h + 1);
+		if (packetsize < sizeof(struct icmp6hdr) +
+		    sizeof(struct ip6hdr) + sizeof(struct udphdr) ||
+		    orig->nh != IPTYPE_UDP)
+			break;
+		switch (icmp6h->code) {
+		case 0:
+			err_code = ICMP_NET_UNREACHABLE;
+			break;
+		case 4:
+			err_code = ICMP_PORT_UNREACHABLE;
+			break;
+		default:
+			err_code = ICMP_HOST_UNREACHABLE;
+			break;
+		}
+		handle_udp_dun((uint8_t *) (orig + 1), packetsize -
+		               sizeof(struct icmp6hdr) - sizeof(struct ip6hdr),
+		               err_code);
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+#ifndef _ICMPV6_H_
+#define _ICMPV6_H_
+
+#include <stdint.h>
+#include <netlib/ipv6.h>
+
+/* ICMPv6 message types (RFC 4443, RFC 4861) */
+#define ICMPV6_DEST_UNREACHABLE        1
+#define ICMPV6_ECHO_REQUEST          128
+#define ICMPV6_ECHO_REPLY            129
+#define ICMPV6_ROUTER_SOLICITATION   133
+#define ICMPV6_ROUTER_ADVERTISEMENT  134
+#define ICMPV6_NEIGHBOUR_SOLICITATION  135
+#define ICMPV6_NEIGHBOUR_ADVERTISEMENT 136
+
+/* Neighbor discovery options */
+#define ND_OPT_SOURCE_LL_ADDR          1
+#define ND_OPT_TARGET_LL_ADDR          2
+#define ND_OPT_PREFIX_INFORMATION      3
+
+/* Flags of the prefix information option */
+#define ND_PREFIX_ONLINK            0x80
+#define ND_PREFIX_AUTONOMOUS        0x40
+
+/* Flags of the neighbor advertisement */
+#define ND_NA_ROUTER          0x80000000
+#define ND_NA_SOLICITED       0x40000000
+#define ND_NA_OVERRIDE        0x20000000
+
+/** \struct icmp6hdr
+ *  A header for ICMPv6-messages, followed by the message body.
+ */
+struct icmp6hdr {
+	uint8_t  type;
+	uint8_t  code;
+	uint16_t checksum;
+	uint32_t data;      /**< Flags, reserved or Echo ID/sequence      */
+} __attribute__ ((packed));
+
+/** \struct nd_option
+ *  A neighbor discovery option; len counts units of 8 bytes.
+ */
+struct nd_option {
+	uint8_t type;
+	uint8_t len;
+	uint8_t data[6];
+} __attribute__ ((packed));
+
+/** \struct nd_prefix_info
+ *  The prefix information option of a router advertisement.
+ */
+struct nd_prefix_info {
+	uint8_t    type;
+	uint8_t    len;
+	uint8_t    prefix_length;
+	uint8_t    flags;
+	uint32_t   valid_lifetime;
+	uint32_t   preferred_lifetime;
+	uint32_t   reserved;
+	ip6_addr_t prefix;
+} __attribute__ ((packed));
+
+/* Sends a Router Solicitation to all routers */
+extern void send_router_solicitation(void);
+
+/* Sends a Neighbor Solicitation for the given address */
+extern void send_neighbour_solicitation(ip6_addr_t *target);
+
+/* Handles ICMPv6-packets that are detected by handle_ipv6. */
+extern int8_t handle_icmpv6(struct ip6hdr *ip6h, uint8_t *packet,
+                            int32_t packetsize);
+
+#endif
@@ -27,6 +27,10 @@
 /* ARP talbe size (+1) */
 #define ARP_ENTRIES 10
 
+/* An unanswered ARP request is repeated ARP_RETRIES times */
+#define ARP_RETRIES     4
+#define ARP_RETRY_MSECS 1000
+
 /* ICMP Message types */
 #define ICMP_ECHO_REPLY            0
 #define ICMP_DST_UNREACHABLE       3
@@ -40,6 +44,16 @@
 #define ICMP_INFORMATION_REQUEST  15
 #define ICMP_INFORMATION_REPLY    16
 
+/* IGMPv2 Message types (RFC 2236) */
+#define IGMP_MEMBERSHIP_QUERY      0x11
+#define IGMP_V1_MEMBERSHIP_REPORT  0x12
+#define IGMP_V2_MEMBERSHIP_REPORT  0x16
+#define IGMP_LEAVE_GROUP           0x17
+
+/* IGMP destination addresses */
+#define IGMP_ALL_SYSTEMS   0xE0000001
+#define IGMP_ALL_ROUTERS   0xE0000002
+
 /** \struct arp_entry
  *  A entry that describes a mapping between IPv4- and MAC-address.
  */
@@ -79,11 +93,27 @@ struct icmphdr {
 	} payload;
 };
 
+/** \struct igmphdr
+ *  IGMPv2 message
+ */
+struct igmphdr {
+	uint8_t  type;
+	uint8_t  max_resp_time;
+	uint16_t checksum;
+	uint32_t group;
+};
+
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> PROTOTYPES <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 static unsigned short
 checksum(unsigned short *packet, int words);
 
+static uint64_t
+checksum_add(uint64_t sum, const void *data, int len);
+
+static uint16_t
+checksum_fold(uint64_t sum);
+
 static void
 arp_send_request(uint32_t dest_ip);
 
@@ -98,12 +128,21 @@ fill_arphdr(uint8_t * packet, uint8_t opcode,
 static arp_entry_t*
 lookup_mac_addr(uint32_t ipv4_addr);
 
+static void
+arp_retry(void);
+
 static void
 fill_udp_checksum(struct iphdr *ipv4_hdr);
 
 static int8_t
 handle_icmp(struct iphdr * iph, uint8_t * packet, int32_t packetsize);
 
+static void
+igmp_send(uint8_t type, uint32_t group, uint32_t dest_ip);
+
+static int8_t
+handle_igmp(uint8_t * packet, int32_t packetsize);
+
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 /* Routing parameters */
@@ -112,11 +151,13 @@ static uint32_t multicast_ip = 0;
 static uint32_t router_ip    = 0;
 static uint32_t subnet_mask  = 0;
 
+/* The NIC completes the UDP checksums (see set_ipv4_csum_offload) */
+static int udp_csum_offload = 0;
+
 /* helper variables */
 static uint32_t ping_dst_ip;
 static const uint8_t null_mac_addr[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 static const uint8_t broadcast_mac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-static       uint8_t multicast_mac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
 /* There are only (ARP_ENTRIES-1) effective entries because
  * the entry that is pointed by arp_producer is never used.
@@ -124,6 +165,7 @@ static       uint8_t multicast_mac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 static unsigned int arp_consumer = 0;
 static unsigned int arp_producer = 0;
 static arp_entry_t  arp_table[ARP_ENTRIES];
+static unsigned int arp_retries;
 
 /* Function pointer send_ip. Points either to send_ipv4() or send_ipv6() */
 int   (*send_ip) (void *, int);
@@ -149,6 +191,8 @@ ipv4_init(void)
 		arp_table[i].eth_len = 0;
 	}
 
+	net_clear_timer(arp_retry);
+
 	/* Set IP send function to send_ipv4() */ 
 	send_ip = &send_ipv4;
 }
@@ -177,28 +221,31 @@ get_ipv4_address(void)
 }
 
 /**
- * IPv4: Set the IPv4 multicast address.
+ * IPv4: Set the IPv4 multicast address. Joining a group is announced
+ *       with an IGMPv2 Membership Report, so that switches with IGMP
+ *       snooping forward the group to us; the previous group is left
+ *       with a Leave Group message.
  *
  * @param  _own_ip  multicast IPv4 address (224.0.0.0 - 239.255.255.255)
  */
 void
 set_ipv4_multicast(uint32_t _multicast_ip)
 {
+	if(multicast_ip == _multicast_ip)
+		return;
+
+	if(multicast_ip != 0)
+		igmp_send(IGMP_LEAVE_GROUP, multicast_ip, IGMP_ALL_ROUTERS);
+
 	// is this IP Multicast out of range (224.0.0.0 - 239.255.255.255)
 	if((htonl(_multicast_ip) < 0xE0000000)
 	|| (htonl(_multicast_ip) > 0xEFFFFFFF)) {
 		multicast_ip = 0;
-		memset(multicast_mac, 0xFF, 6);
 		return;
 	}
 
 	multicast_ip = _multicast_ip;
-	multicast_mac[0] = 0x01;
-	multicast_mac[1] = 0x00;
-	multicast_mac[2] = 0x5E;
-	multicast_mac[3] = (uint8_t) 0x7F & (multicast_ip >> 16);
-	multicast_mac[4] = (uint8_t) 0xFF & (multicast_ip >>  8);
-	multicast_mac[5] = (uint8_t) 0xFF & (multicast_ip >>  0);
+	igmp_send(IGMP_V2_MEMBERSHIP_REPORT, multicast_ip, multicast_ip);
 }
 
 /**
@@ -308,6 +355,7 @@ handle_ipv4(uint8_t * ip_packet, int32_t packetsize)
 {
 	struct iphdr * iph;
 	int32_t old_sum;
+	int hlen;
 	static uint8_t ip_heap[65536 + ETH_MTU_SIZE];
 
 	if (packetsize < sizeof(struct iphdr))
@@ -315,20 +363,31 @@ handle_ipv4(uint8_t * ip_packet, int32_t packetsize)
 
 	iph = (struct iphdr * ) ip_packet;
 
+	// header length incl. options (e.g. Router Alert of IGMP queries)
+	hlen = (iph -> ip_hlv & 0x0F) * 4;
+	if (hlen < sizeof(struct iphdr) || hlen > packetsize)
+		return -1;
+
 	/* Drop it if destination IPv4 address is no IPv4 Broadcast, no
-	 * registered IPv4 Multicast and not our Unicast address
+	 * registered IPv4 Multicast and not our Unicast address. IGMP
+	 * queries to all systems are accepted while we are in a group.
 	 */
 	if((multicast_ip == 0 && iph->ip_dst >= 0xE0000000 && iph->ip_dst <= 0xEFFFFFFF)
 	|| (multicast_ip != iph->ip_dst && iph->ip_dst != 0xFFFFFFFF &&
+	    iph->ip_dst != IGMP_ALL_SYSTEMS &&
 	    own_ip != 0 && iph->ip_dst != own_ip)) {
 		return -1;
 	}
 
 	old_sum = iph -> ip_sum;
 	iph -> ip_sum = 0;
-	if (old_sum != checksum((uint16_t *) iph, sizeof (struct iphdr) >> 1))
+	if (old_sum != checksum((uint16_t *) iph, hlen >> 1))
 		return -1; // Wrong IP checksum
 
+	// IGMP messages are small and never fragmented
+	if (iph -> ip_p == IPTYPE_IGMP)
+		return handle_igmp(ip_packet + hlen, iph -> ip_len - hlen);
+
 	// is it the first fragment in a packet?
 	if (((iph -> ip_off) & 0x1FFF) == 0) {
 		// is it part of more fragments?
@@ -422,6 +481,7 @@ send_ipv4(void* buffer, int len)
 	arp_entry_t *arp_entry;
 	struct iphdr *ip;
 	const uint8_t *mac_addr = 0;
+	uint8_t multicast_mac[6] = {0x01, 0x00, 0x5E, 0x00, 0x00, 0x00};
 
 	if(len + sizeof(struct ethhdr) > ETH_MTU_SIZE)
 		return -1;
@@ -443,9 +503,9 @@ send_ipv4(void* buffer, int len)
 		ip->ip_dst = htonl( multicast_ip );
 	}
 
-	// Calculate the IPv4 checksum
+	// Calculate the IPv4 checksum (header incl. options)
 	ip->ip_sum = 0;
-	ip->ip_sum = checksum((uint16_t *) ip, sizeof (struct iphdr) >> 1);
+	ip->ip_sum = checksum((uint16_t *) ip, (ip->ip_hlv & 0x0F) * 2);
 
 	// if payload type is UDP, then we need to calculate the
 	// UDP checksum that depends on the IP header
@@ -460,8 +520,12 @@ send_ipv4(void* buffer, int len)
 		arp_entry = &arp_table[arp_producer];
 		mac_addr = broadcast_mac;
 	}
-	else if(ip->ip_dst == multicast_ip) {
+	else if(ip->ip_dst >= 0xE0000000 && ip->ip_dst <= 0xEFFFFFFF) {
+		// multicast MAC address of the group (RFC 1112 6.4)
 		arp_entry = &arp_table[arp_producer];
+		multicast_mac[3] = (uint8_t) 0x7F & (ip->ip_dst >> 16);
+		multicast_mac[4] = (uint8_t) 0xFF & (ip->ip_dst >>  8);
+		multicast_mac[5] = (uint8_t) 0xFF & (ip->ip_dst >>  0);
 		mac_addr = multicast_mac;
 	}
 	else {
@@ -501,6 +565,10 @@ send_ipv4(void* buffer, int len)
 		       buffer, len);
 		arp_entry->eth_len = len + sizeof(struct ethhdr);
 
+		// repeat the ARP request if there is no answer
+		arp_retries = 0;
+		net_set_timer(arp_retry, ARP_RETRY_MSECS);
+
 		return 0;
 	}
 
@@ -511,6 +579,19 @@ send_ipv4(void* buffer, int len)
 	return send_ether(arp_entry->eth_frame, len + sizeof(struct ethhdr));
 }
 
+/**
+ * IPv4: Tells whether the NIC completes the UDP checksums of sent
+ *       packets. In this case only the pseudo header sum is put into
+ *       the UDP-header, the NIC adds the rest (see fill_udp_checksum).
+ *
+ * @param  enable      TRUE - the NIC has enabled the checksum offload
+ */
+void
+set_ipv4_csum_offload(int enable)
+{
+	udp_csum_offload = enable;
+}
+
 /**
  * IPv4: Calculate UDP checksum. Places the result into the UDP-header.
  *      <p>
@@ -522,32 +603,77 @@ send_ipv4(void* buffer, int len)
 static void
 fill_udp_checksum(struct iphdr *ipv4_hdr)
 {
-	int i;
-	unsigned long checksum = 0;
-	struct iphdr ip_hdr;
-	char *ptr;
+	uint64_t sum;
+	uint16_t udp_sum;
 	udp_hdr_t *udp_hdr;
 
 	udp_hdr = (udp_hdr_t *) (ipv4_hdr + 1);
 	udp_hdr->uh_sum = 0;
 
-	memset(&ip_hdr, 0, sizeof(struct iphdr));
-	ip_hdr.ip_src    = ipv4_hdr->ip_src;
-	ip_hdr.ip_dst    = ipv4_hdr->ip_dst;
-	ip_hdr.ip_len    = udp_hdr->uh_ulen;
-	ip_hdr.ip_p      = ipv4_hdr->ip_p;
+	// pseudo header: addresses, protocol and UDP length
+	sum = (uint64_t) ipv4_hdr->ip_src + ipv4_hdr->ip_dst +
+	      ipv4_hdr->ip_p + udp_hdr->uh_ulen;
+
+	if (udp_csum_offload) {
+		udp_hdr->uh_sum = checksum_fold(sum);
+		return;
+	}
+
+	udp_sum = ~checksum_fold(checksum_add(sum, udp_hdr, udp_hdr->uh_ulen));
+	// zero means "no checksum", so send all ones instead (RFC 768)
+	udp_hdr->uh_sum = udp_sum ? udp_sum : 0xffff;
+}
 
-	ptr = (char*) udp_hdr;
-	for (i = 0; i < udp_hdr->uh_ulen; i+=2)
-		checksum += *((uint16_t*) &ptr[i]);
+/**
+ * IPv4: Adds data to a ones' complement sum. The data is read as 32-bit
+ *       words into a 64-bit sum, eight words per loop, so the carries
+ *       need to be folded only once (see checksum_fold).
+ *
+ * @param  sum        Sum of the data before (not folded)
+ * @param  data       Points to the data
+ * @param  len        Length of the data in bytes
+ * @return            New sum (not folded)
+ */
+static uint64_t
+checksum_add(uint64_t sum, const void *data, int len)
+{
+	const uint32_t *ptr = data;
+	const uint8_t *tail;
+
+	for (; len >= 32; len -= 32, ptr += 8)
+		sum += (uint64_t) ptr[0] + ptr[1] + ptr[2] + ptr[3] +
+		       ptr[4] + ptr[5] + ptr[6] + ptr[7];
+	for (; len >= 4; len -= 4)
+		sum += *ptr++;
+
+	tail = (const uint8_t *) ptr;
+	if (len >= 2) {
+		sum += *(const uint16_t *) tail;
+		tail += 2;
+		len -= 2;
+	}
+	if (len) {
+		uint8_t last[2] = { tail[0], 0 };
+		sum += *(uint16_t *) last;
+	}
 
-	ptr = (char*) &ip_hdr;
-	for (i = 0; i < sizeof(struct iphdr); i+=2)
-		checksum += *((uint16_t*) &ptr[i]);
+	return sum;
+}
 
-	checksum = (checksum >> 16) + (checksum & 0xffff);
-	checksum += (checksum >> 16);
-	udp_hdr->uh_sum = ~checksum;
+/**
+ * IPv4: Folds a 64-bit sum into a 16-bit ones' complement sum.
+ *
+ * @param  sum        Sum as returned by checksum_add
+ * @return            Folded sum (not complemented)
+ */
+static uint16_t
+checksum_fold(uint64_t sum)
+{
+	sum = (sum >> 32) + (sum & 0xffffffff);
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum = (sum >> 16) + (sum & 0xffff);
+	return sum;
 }
 
 /**
@@ -561,14 +687,7 @@ fill_udp_checksum(struct iphdr *ipv4_hdr)
 static unsigned short
 checksum(unsigned short * packet, int words)
 {
-	unsigned long checksum;
-
-	for (checksum = 0; words > 0; words--)
-		checksum += *packet++;
-	checksum = (checksum >> 16) + (checksum & 0xffff);
-	checksum += (checksum >> 16);
-
-	return ~checksum;
+	return ~checksum_fold(checksum_add(0, packet, words * 2));
 }
 
 static arp_entry_t*
@@ -605,6 +724,28 @@ arp_send_request(uint32_t dest_ip)
 	     sizeof(struct ethhdr) + sizeof(struct arphdr));
 }
 
+/**
+ * ARP: Timer callback that repeats the ARP requests for all packets which
+ *      are still waiting for the MAC address of their destination.
+ */
+static void
+arp_retry(void)
+{
+	unsigned int i;
+	int pending = 0;
+
+	for(i=arp_consumer; i != arp_producer; i = ((i+1)%ARP_ENTRIES) ) {
+		if(arp_table[i].eth_len > 0
+		&& memcmp(arp_table[i].mac_addr, null_mac_addr, 6) == 0) {
+			arp_send_request(arp_table[i].ipv4_addr);
+			pending = 1;
+		}
+	}
+
+	if(pending && ++arp_retries < ARP_RETRIES)
+		net_set_timer(arp_retry, ARP_RETRY_MSECS);
+}
+
 /**
  * ARP: Sends an ARP-reply package.
  *      This package is used to serve foreign requests (in case IP in
@@ -869,3 +1010,70 @@ handle_icmp(struct iphdr * iph, uint8_t * packet, int32_t packetsize)
 	}
 	return 0;
 }
+
+/**
+ * IGMP: Sends an IGMPv2 message (RFC 2236). It carries the Router Alert
+ *       option and a TTL of 1, so it never leaves the local network.
+ *
+ * @param  type      IGMP_V2_MEMBERSHIP_REPORT or IGMP_LEAVE_GROUP
+ * @param  group     multicast group the message is about
+ * @param  dest_ip   the group itself for reports, all routers for leaves
+ */
+static void
+igmp_send(uint8_t type, uint32_t group, uint32_t dest_ip)
+{
+	uint8_t packet[sizeof(struct iphdr) + 4 + sizeof(struct igmphdr)];
+	struct iphdr *iph = (struct iphdr *) packet;
+	uint8_t *router_alert = &packet[sizeof(struct iphdr)];
+	struct igmphdr *igmph = (struct igmphdr *) &packet[sizeof(struct iphdr) + 4];
+
+	if (own_ip == 0)
+		return;
+
+	fill_iphdr(packet, sizeof(packet), IPTYPE_IGMP, 0, dest_ip);
+	iph -> ip_hlv = 0x46;
+	iph -> ip_tos = 0;
+	iph -> ip_ttl = 1;
+
+	router_alert[0] = 0x94;
+	router_alert[1] = 4;
+	router_alert[2] = 0;
+	router_alert[3] = 0;
+
+	igmph -> type = type;
+	igmph -> max_resp_time = 0;
+	igmph -> checksum = 0;
+	igmph -> group = htonl(group);
+	igmph -> checksum = checksum((unsigned short *) igmph,
+	                             sizeof(struct igmphdr) >> 1);
+
+	send_ipv4(packet, sizeof(packet));
+}
+
+/**
+ * IGMP: Handles IGMP-packets. A query for our group, or a general query,
+ *       is answered with a membership report at once; the random delay
+ *       of RFC 2236 only matters with many members on one segment.
+ *
+ * @param  packet     IGMP message
+ * @param  packetsize Length of the message
+ * @return            ZERO - packet handled successfully;
+ *                    NON ZERO - packet was not handled (e.g. bad format)
+ */
+static int8_t
+handle_igmp(uint8_t * packet, int32_t packetsize)
+{
+	struct igmphdr *igmph = (struct igmphdr *) packet;
+
+	if (packetsize < sizeof(struct igmphdr))
+		return -1;
+
+	if (checksum((unsigned short *) packet, packetsize >> 1) != 0)
+		return -1;
+
+	if (igmph -> type == IGMP_MEMBERSHIP_QUERY && multicast_ip != 0
+	 && (igmph -> group == 0 || igmph -> group == multicast_ip))
+		igmp_send(IGMP_V2_MEMBERSHIP_REPORT, multicast_ip, multicast_ip);
+
+	return 0;
+}
@@ -17,6 +17,7 @@
 #include <stdint.h>
 
 #define IPTYPE_ICMP         1
+#define IPTYPE_IGMP         2
 
 /** \struct iphdr
  *  A header for IP-packets.
@@ -69,6 +70,7 @@ extern void     set_ipv4_router(uint32_t router_ip);
 extern uint32_t get_ipv4_router(void);
 extern void     set_ipv4_netmask(uint32_t subnet_mask);
 extern uint32_t get_ipv4_netmask(void);
+extern void     set_ipv4_csum_offload(int enable);
 
 extern int   (*send_ip) (void *, int);
 
@@ -0,0 +1,566 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> ALGORITHMS <<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/** \file ipv6.c <pre>
+ * ************************ IPv6 address configuration ********************
+ *
+ * set_ipv6_address(NULL) configures the link-local address fe80::/64 with
+ * an interface identifier derived from the MAC address (EUI-64) and sends
+ * a Router Solicitation. It is repeated up to RTR_SOLICITATIONS times every
+ * RTR_SOLICITATION_MSECS until a router answers (RFC 4861 6.3.7). If a
+ * Router Advertisement with an autonomous /64 prefix arrives, the global
+ * address is the prefix plus the same interface identifier (stateless
+ * address autoconfiguration, RFC 4862). Duplicate address detection is not
+ * done.
+ *
+ * MAC addresses of neighbors are resolved with Neighbor Solicitations
+ * (RFC 4861) and kept in the neighbor cache (see ndp.c). Destinations
+ * outside of the link are reached through the router that sent the
+ * Router Advertisement.
+ *
+ * ************************************************************************
+ * </pre> */
+
+/*>>>>>>>>>>>>>>>>>>>>> DEFINITIONS & DECLARATIONS <<<<<<<<<<<<<<<<<<<<<<*/
+
+#include <ipv6.h>
+#include <icmpv6.h>
+#include <ndp.h>
+#include <ipv4.h>
+#include <udp.h>
+#include <ethernet.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+/* MAX_RTR_SOLICITATIONS and RTR_SOLICITATION_INTERVAL of RFC 4861 10 */
+#define RTR_SOLICITATIONS          3
+#define RTR_SOLICITATION_MSECS  4000
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+static ip6_addr_t link_local_ip6;
+static ip6_addr_t global_ip6;
+static int        has_global_ip6 = 0;
+
+static struct ip6_prefix own_prefix;
+static ip6_addr_t router_ip6;
+static int        has_router = 0;
+static int        rtr_solicitations;
+
+static uint8_t ether_packet[ETH_MTU_SIZE];
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>> IMPLEMENTATION <<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/**
+ * IPv6: Set the own IPv6 address and initialize the IPv6 layer.
+ *
+ * @param  _own_ip6  client IPv6 address or NULL for autoconfiguration
+ */
+void
+set_ipv6_address(ip6_addr_t *_own_ip6)
+{
+	const uint8_t *mac = get_mac_address();
+
+	ndp_init();
+	has_router = 0;
+	memset(&own_prefix, 0, sizeof(own_prefix));
+
+	// fe80::/64 plus the modified EUI-64 of the MAC address
+	memset(&link_local_ip6, 0, sizeof(ip6_addr_t));
+	link_local_ip6.addr[0] = 0xfe;
+	link_local_ip6.addr[1] = 0x80;
+	link_local_ip6.addr[8] = mac[0] ^ 0x02;
+	link_local_ip6.addr[9] = mac[1];
+	link_local_ip6.addr[10] = mac[2];
+	link_local_ip6.addr[11] = 0xff;
+	link_local_ip6.addr[12] = 0xfe;
+	link_local_ip6.addr[13] = mac[3];
+	link_local_ip6.addr[14] = mac[4];
+	link_local_ip6.addr[15] = mac[5];
+
+	has_global_ip6 = 0;
+	if (_own_ip6 && !ip6_is_linklocal(_own_ip6)) {
+		memcpy(&global_ip6, _own_ip6, sizeof(ip6_addr_t));
+		has_global_ip6 = 1;
+	}
+
+	/* Set IP send function to send_ipv6() */
+	send_ip = &send_ipv6;
+
+	if (!_own_ip6)
+		ipv6_find_router();
+}
+
+/**
+ * IPv6: Timer callback that repeats the Router Solicitation as long as no
+ *       router has answered.
+ */
+static void
+rtr_solicitation_retry(void)
+{
+	if (has_router)
+		return;
+
+	send_router_solicitation();
+	if (++rtr_solicitations < RTR_SOLICITATIONS)
+		net_set_timer(rtr_solicitation_retry, RTR_SOLICITATION_MSECS);
+}
+
+/**
+ * IPv6: Looks for the default router with Router Solicitations; the
+ *       Router Advertisement is handled in the background.
+ */
+void
+ipv6_find_router(void)
+{
+	rtr_solicitations = 0;
+	rtr_solicitation_retry();
+}
+
+/**
+ * IPv6: Get the own IPv6 address.
+ *
+ * @return  the global address if there is one, otherwise the link-local one
+ */
+ip6_addr_t *
+get_ipv6_address(void)
+{
+	return has_global_ip6 ? &global_ip6 : &link_local_ip6;
+}
+
+/**
+ * IPv6: Get the own link-local address.
+ *
+ * @return  link-local address (fe80::/64)
+ */
+ip6_addr_t *
+get_ipv6_link_local(void)
+{
+	return &link_local_ip6;
+}
+
+/**
+ * IPv6: Configures the global address from an autonomous prefix of a
+ *       Router Advertisement (if there is no global address yet).
+ *
+ * @param  prefix   on-link prefix
+ * @param  length   prefix length in bits (always 64)
+ */
+void
+ipv6_set_prefix(ip6_addr_t *prefix, uint8_t length)
+{
+	if (has_global_ip6)
+		return;
+
+	memcpy(&own_prefix.prefix, prefix, sizeof(ip6_addr_t));
+	own_prefix.length = length;
+
+	memcpy(&global_ip6.addr[0], &prefix->addr[0], 8);
+	memcpy(&global_ip6.addr[8], &link_local_ip6.addr[8], 8);
+	has_global_ip6 = 1;
+}
+
+/**
+ * IPv6: Sets the default router.
+ *
+ * @param  router   link-local address of the router
+ * @param  mac      MAC address of the router or NULL if not known
+ */
+void
+ipv6_set_router(ip6_addr_t *router, const uint8_t *mac)
+{
+	memcpy(&router_ip6, router, sizeof(ip6_addr_t));
+	has_router = 1;
+	if (mac)
+		update_neighbor(router, mac);
+}
+
+/**
+ * IPv6: Checks whether an address is one of ours.
+ *
+ * @param  ip   IPv6 address
+ * @return      TRUE if ip is our link-local or global address
+ */
+int
+ipv6_is_own(ip6_addr_t *ip)
+{
+	if (!memcmp(ip, &link_local_ip6, sizeof(ip6_addr_t)))
+		return 1;
+	return has_global_ip6 && !memcmp(ip, &global_ip6, sizeof(ip6_addr_t));
+}
+
+int
+ip6_is_multicast(ip6_addr_t *ip)
+{
+	return ip->addr[0] == 0xff;
+}
+
+int
+ip6_is_linklocal(ip6_addr_t *ip)
+{
+	return ip->addr[0] == 0xfe && (ip->addr[1] & 0xc0) == 0x80;
+}
+
+/**
+ * IPv6: Multicast MAC address of an IPv6 multicast address (RFC 2464 7)
+ */
+void
+ip6_multicast_mac(ip6_addr_t *ip, uint8_t *mac)
+{
+	mac[0] = 0x33;
+	mac[1] = 0x33;
+	memcpy(&mac[2], &ip->addr[12], 4);
+}
+
+/**
+ * IPv6: Checks if we have to receive a packet sent to this address: own
+ *       addresses, all-nodes and our solicited-node multicast addresses.
+ */
+static int
+ip6_accept(ip6_addr_t *dst)
+{
+	static const uint8_t all_nodes[16] = { 0xff, 0x02, 0, 0, 0, 0, 0, 0,
+	                                       0, 0, 0, 0, 0, 0, 0, 1 };
+	static const uint8_t solicited[13] = { 0xff, 0x02, 0, 0, 0, 0, 0, 0,
+	                                       0, 0, 0, 1, 0xff };
+
+	if (ipv6_is_own(dst) || !memcmp(dst, all_nodes, 16))
+		return 1;
+
+	if (!memcmp(dst, solicited, 13)) {
+		if (!memcmp(&dst->addr[13], &link_local_ip6.addr[13], 3))
+			return 1;
+		if (has_global_ip6 &&
+		    !memcmp(&dst->addr[13], &global_ip6.addr[13], 3))
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * IPv6: Creates IPv6-packet. Places IPv6-header in a packet and fills it
+ *       with corresponding information.
+ *       <p>
+ *       Use this function with similar functions for other network layers
+ *       (fill_ethhdr, fill_udphdr, fill_dnshdr, fill_btphdr).
+ *
+ * @param  packet          Points to the place where IPv6-header must be
+ *                         placed.
+ * @param  payload_length  Size of the payload (without IPv6-header)
+ * @param  ip_proto        Type of the next level protocol (e.g. UDP).
+ * @param  ip6_src         Sender IPv6 address, NULL to let send_ipv6 choose
+ * @param  ip6_dst         Receiver IPv6 address
+ */
+void
+fill_ip6hdr(uint8_t *packet, uint16_t payload_length, uint8_t ip_proto,
+            ip6_addr_t *ip6_src, ip6_addr_t *ip6_dst)
+{
+	struct ip6hdr *ip6h = (struct ip6hdr *) packet;
+
+	ip6h->ver_tc_fl = htonl(6 << 28);
+	ip6h->pl = htons(payload_length);
+	ip6h->nh = ip_proto;
+	ip6h->hl = 255;
+	if (ip6_src)
+		memcpy(&ip6h->src, ip6_src, sizeof(ip6_addr_t));
+	else
+		memset(&ip6h->src, 0, sizeof(ip6_addr_t));
+	memcpy(&ip6h->dst, ip6_dst, sizeof(ip6_addr_t));
+}
+
+/**
+ * IPv6: Calculates the checksum of an upper layer packet (RFC 2460 8.1).
+ *       If the checksum field of the packet is filled in, the result is
+ *       zero for a correct packet.
+ *
+ * @param  ip6h    IPv6-header (for the pseudo header)
+ * @param  packet  UDP or ICMPv6 packet
+ * @param  len     size of packet
+ * @return         checksum
+ */
+uint16_t
+ip6_checksum(struct ip6hdr *ip6h, uint8_t *packet, int len)
+{
+	uint8_t pseudo[40];
+	uint32_t sum = 0;
+	int i;
+
+	memcpy(pseudo, &ip6h->src, 16);
+	memcpy(pseudo + 16, &ip6h->dst, 16);
+	pseudo[32] = len >> 24;
+	pseudo[33] = len >> 16;
+	pseudo[34] = len >> 8;
+	pseudo[35] = len;
+	pseudo[36] = pseudo[37] = pseudo[38] = 0;
+	pseudo[39] = ip6h->nh;
+
+	for (i = 0; i < 40; i += 2)
+		sum += *(uint16_t *) &pseudo[i];
+	for (i = 0; i + 1 < len; i += 2)
+		sum += *(uint16_t *) &packet[i];
+	if (len & 1) {
+		uint8_t last[2] = { packet[len - 1], 0 };
+		sum += *(uint16_t *) last;
+	}
+
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += (sum >> 16);
+	return ~sum;
+}
+
+/**
+ * IPv6: Handles IPv6-packets according to Receive-handle diagram.
+ *       Extension headers are not supported.
+ *
+ * @param  ip6_packet IPv6-packet to be handled
+ * @param  packetsize Length of the packet
+ * @return            ZERO - packet handled successfully;
+ *                    NON ZERO - packet was not handled (e.g. bad format)
+ */
+int8_t
+handle_ipv6(uint8_t *ip6_packet, int32_t packetsize)
+{
+	struct ip6hdr *ip6h = (struct ip6hdr *) ip6_packet;
+	ip6_addr_t dst;
+	int32_t payload;
+
+	if (packetsize < sizeof(struct ip6hdr))
+		return -1; // packet is too small
+
+	if ((htonl(ip6h->ver_tc_fl) >> 28) != 6)
+		return -1;
+
+	payload = htons(ip6h->pl);
+	if (payload > packetsize - sizeof(struct ip6hdr))
+		return -1;
+
+	memcpy(&dst, &ip6h->dst, sizeof(ip6_addr_t));
+	if (!ip6_accept(&dst))
+		return -1;
+
+	switch (ip6h->nh) {
+	case IPTYPE_ICMPV6:
+		return handle_icmpv6(ip6h, ip6_packet + sizeof(struct ip6hdr),
+		                     payload);
+	case IPTYPE_UDP:
+		// the UDP checksum is mandatory for IPv6 (RFC 2460 8.1)
+		if (payload < sizeof(struct udphdr) ||
+		    !((struct udphdr *) (ip6h + 1))->uh_sum ||
+		    ip6_checksum(ip6h, ip6_packet + sizeof(struct ip6hdr),
+		                 payload))
+			return -1; // Wrong UDP checksum
+		return handle_udp(ip6_packet + sizeof(struct ip6hdr), payload);
+	default:
+		break;
+	}
+	return -1; // Unknown protocol
+}
+
+/**
+ * IPv6: Send IPv6-packets.
+ *
+ *       Before the packet is sent, an unspecified source address is
+ *       replaced by the own address (link-local for link-local and
+ *       link-scope multicast destinations), and the UDP or ICMPv6
+ *       checksum is calculated.
+ *
+ *       If the MAC address of the next hop is not known yet, a Neighbor
+ *       Solicitation is sent and the packet is stored in the neighbor cache
+ *       until the Neighbor Advertisement arrives.
+ *
+ * @param  buffer     IPv6-packet to be sent
+ * @param  len        Length of the packet
+ * @return            -2 - packet stored, MAC address is still being resolved
+ *                    -1 - packet dropped (bad format)
+ *                     0 - packet stored (Neighbor Solicitation sent)
+ *                    >0 - packet sent (number of transmitted bytes)
+ */
+int
+send_ipv6(void *buffer, int len)
+{
+	struct ip6hdr *ip6h = (struct ip6hdr *) buffer;
+	uint8_t *payload = (uint8_t *) (ip6h + 1);
+	int payload_len = len - sizeof(struct ip6hdr);
+	uint8_t mac[6];
+	ip6_addr_t dst, *next_hop;
+	struct neighbor *n;
+	int pending;
+
+	if (len + sizeof(struct ethhdr) > ETH_MTU_SIZE ||
+	    len < sizeof(struct ip6hdr))
+		return -1;
+
+	// the header is packed, so work on an aligned copy of the address
+	memcpy(&dst, &ip6h->dst, sizeof(ip6_addr_t));
+
+	if (!ip6h->src.part[0] && !ip6h->src.part[1]) {
+		if (ip6_is_linklocal(&dst) ||
+		    (ip6_is_multicast(&dst) && (dst.addr[1] & 0x0f) <= 2))
+			memcpy(&ip6h->src, &link_local_ip6, sizeof(ip6_addr_t));
+		else
+			memcpy(&ip6h->src, get_ipv6_address(),
+			       sizeof(ip6_addr_t));
+	}
+
+	if (ip6h->nh == IPTYPE_UDP && payload_len >= sizeof(struct udphdr)) {
+		struct udphdr *udph = (struct udphdr *) payload;
+		udph->uh_sum = 0;
+		udph->uh_sum = ip6_checksum(ip6h, payload, payload_len);
+		// zero means "no checksum", which is not allowed for IPv6
+		if (!udph->uh_sum)
+			udph->uh_sum = 0xffff;
+	}
+	else if (ip6h->nh == IPTYPE_ICMPV6 &&
+	         payload_len >= sizeof(struct icmp6hdr)) {
+		struct icmp6hdr *icmp6h = (struct icmp6hdr *) payload;
+		icmp6h->checksum = 0;
+		icmp6h->checksum = ip6_checksum(ip6h, payload, payload_len);
+	}
+
+	if (ip6_is_multicast(&dst)) {
+		ip6_multicast_mac(&dst, mac);
+		fill_ethhdr(ether_packet, htons(ETHERTYPE_IPv6),
+		            get_mac_address(), mac);
+		memcpy(ether_packet + sizeof(struct ethhdr), buffer, len);
+		return send_ether(ether_packet, len + sizeof(struct ethhdr));
+	}
+
+	// Destinations that are not on the link are reached via the router
+	if (has_router && !ip6_is_linklocal(&dst) &&
+	    (!own_prefix.length || memcmp(&dst, &own_prefix.prefix, 8)))
+		next_hop = &router_ip6;
+	else
+		next_hop = &dst;
+
+	n = find_neighbor(next_hop);
+	if (n && n->state == NB_REACHABLE) {
+		fill_ethhdr(ether_packet, htons(ETHERTYPE_IPv6),
+		            get_mac_address(), n->mac);
+		memcpy(ether_packet + sizeof(struct ethhdr), buffer, len);
+		return send_ether(ether_packet, len + sizeof(struct ethhdr));
+	}
+
+	// keep the newest packet until the MAC address is known
+	pending = n != NULL;
+	if (!n)
+		n = add_neighbor(next_hop);
+	fill_ethhdr(n->eth_frame, htons(ETHERTYPE_IPv6), get_mac_address(),
+	            n->mac);
+	memcpy(n->eth_frame + sizeof(struct ethhdr), buffer, len);
+	n->eth_len = len + sizeof(struct ethhdr);
+
+	send_neighbour_solicitation(next_hop);
+
+	return pending ? -2 : 0;
+}
+
+/**
+ * IPv6: Converts an address in text form (RFC 4291 2.2, without the
+ *       embedded IPv4 form) to binary.
+ *
+ * @param  str   e.g. "fe80::1"
+ * @param  ip    16 bytes for the result
+ * @return       TRUE - address converted; FALSE - bad format
+ */
+int
+parseip6(const char *str, uint8_t *ip)
+{
+	uint16_t groups[8];
+	int n = 0, gap = -1, digits;
+	uint16_t val;
+
+	if (str[0] == ':') {
+		if (str[1] != ':')
+			return 0;
+		str++;
+	}
+
+	while (*str) {
+		if (*str == ':') {
+			if (gap >= 0)
+				return 0; // only one "::"
+			gap = n;
+			str++;
+			if (!*str)
+				break;
+		}
+		val = 0;
+		for (digits = 0; isxdigit(*str); digits++, str++) {
+			if (digits == 4)
+				return 0;
+			val = (val << 4) | (isdigit(*str) ? *str - '0' :
+			                    (tolower(*str) - 'a' + 10));
+		}
+		if (!digits || n == 8)
+			return 0;
+		groups[n++] = val;
+		if (*str == ':') {
+			str++;
+			if (!*str)
+				return 0;
+		}
+		else if (*str)
+			return 0;
+	}
+
+	if (gap < 0 && n != 8)
+		return 0;
+	if (gap >= 0 && n == 8)
+		return 0;
+
+	memset(ip, 0, 16);
+	for (digits = 0; digits < n; digits++) {
+		int pos = digits;
+		if (gap >= 0 && digits >= gap)
+			pos += 8 - n;
+		ip[pos * 2] = groups[digits] >> 8;
+		ip[pos * 2 + 1] = groups[digits] & 0xff;
+	}
+	return 1;
+}
+
+/**
+ * IPv6: Converts an address to text, with the longest run of zero groups
+ *       written as "::" (RFC 5952).
+ *
+ * @param  ip    16 bytes of the address
+ * @param  str   buffer for at least 40 characters
+ */
+void
+ipv6_to_str(const uint8_t *ip, char *str)
+{
+	int i, j, best = -1, best_len = 1;
+
+	for (i = 0; i < 8; i = j + 1) {
+		for (j = i; j < 8 && !ip[j * 2] && !ip[j * 2 + 1]; j++)
+			;
+		if (j - i > best_len) {
+			best = i;
+			best_len = j - i;
+		}
+	}
+
+	*str = 0;
+	for (i = 0; i < 8; i++) {
+		if (i == best) {
+			str += sprintf(str, "::");
+			i += best_len - 1;
+			continue;
+		}
+		str += sprintf(str, "%s%x", (i && i != best + best_len) ?
+		               ":" : "", (ip[i * 2] << 8) | ip[i * 2 + 1]);
+	}
+}
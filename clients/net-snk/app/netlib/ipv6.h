@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+#ifndef _IPV6_H_
+#define _IPV6_H_
+
+#include <stdint.h>
+
+#define IPTYPE_ICMPV6          0x3A
+
+/** \union ip6_addr_t
+ *  An IPv6 address, in network byte order.
+ */
+typedef union {
+	uint8_t  addr[16];
+	uint64_t part[2];
+} ip6_addr_t;
+
+/** \struct ip6hdr
+ *  A header for IPv6-packets.
+ *  For more information see RFC 2460.
+ */
+struct ip6hdr {
+	uint32_t ver_tc_fl;   /**< Version, traffic class and flow label    */
+	uint16_t pl;          /**< Payload length (without this header)     */
+	uint8_t  nh;          /**< Next header (protocol of the payload)    */
+	uint8_t  hl;          /**< Hop limit                                */
+	ip6_addr_t src;       /**< Source IPv6 address                      */
+	ip6_addr_t dst;       /**< Destination IPv6 address                 */
+} __attribute__ ((packed));
+
+/** \struct ip6_prefix
+ *  An on-link prefix, learned from a Router Advertisement.
+ */
+struct ip6_prefix {
+	ip6_addr_t prefix;
+	uint8_t    length;
+};
+
+/*>>>>>>>>>>>>> Initialization of the IPv6 network layer. <<<<<<<<<<<<<*/
+
+/* Sets the own address; NULL configures a link-local address (from the
+ * MAC address) and starts the stateless autoconfiguration */
+extern void        set_ipv6_address(ip6_addr_t *own_ip6);
+/* Returns the best own address: global if known, link-local otherwise */
+extern ip6_addr_t *get_ipv6_address(void);
+extern ip6_addr_t *get_ipv6_link_local(void);
+
+/* Sends Router Solicitations until a router answers */
+extern void ipv6_find_router(void);
+
+/* Stateless address autoconfiguration (called for Router Advertisements) */
+extern void ipv6_set_prefix(ip6_addr_t *prefix, uint8_t length);
+extern void ipv6_set_router(ip6_addr_t *router, const uint8_t *mac);
+extern int  ipv6_is_own(ip6_addr_t *ip);
+
+/* fills the IPv6 header; ip6_src NULL means "choose the own address" */
+extern void fill_ip6hdr(uint8_t *packet, uint16_t payload_length,
+                        uint8_t ip_proto, ip6_addr_t *ip6_src,
+                        ip6_addr_t *ip6_dst);
+
+/* Sends an IPv6 packet. Resolving the MAC address (neighbor discovery)
+ * and the UDP/ICMPv6 checksums are done in the background. */
+extern int send_ipv6(void *buffer, int len);
+
+/* Handles IPv6-packets that are detected by receive_ether. */
+extern int8_t handle_ipv6(uint8_t *packet, int32_t packetsize);
+
+/* Checksum of an upper layer packet (including the pseudo header) */
+extern uint16_t ip6_checksum(struct ip6hdr *ip6h, uint8_t *packet,
+                             int len);
+
+/* Conversion between text and binary representation */
+extern int  parseip6(const char *str, uint8_t *ip);
+extern void ipv6_to_str(const uint8_t *ip, char *str);
+
+/* Multicast addresses and their MAC addresses */
+extern int  ip6_is_multicast(ip6_addr_t *ip);
+extern int  ip6_is_linklocal(ip6_addr_t *ip);
+extern void ip6_multicast_mac(ip6_addr_t *ip, uint8_t *mac);
+
+#endif
@@ -0,0 +1,101 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*>>>>>>>>>>>>>>>>>>>>> DEFINITIONS & DECLARATIONS <<<<<<<<<<<<<<<<<<<<<<*/
+
+#include <ndp.h>
+#include <ethernet.h>
+#include <string.h>
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/* The neighbor cache is used round robin: if it is full, the entry that
+ * was added first is replaced. */
+static struct neighbor neighbor_cache[NDP_ENTRIES];
+static unsigned int    neighbor_next = 0;
+
+/*>>>>>>>>>>>>>>>>>>>>>>>>>>>> IMPLEMENTATION <<<<<<<<<<<<<<<<<<<<<<<<<<<*/
+
+/**
+ * NDP: Clears the neighbor cache.
+ */
+void
+ndp_init(void)
+{
+	memset(neighbor_cache, 0, sizeof(neighbor_cache));
+	neighbor_next = 0;
+}
+
+/**
+ * NDP: Looks up an IPv6 address in the neighbor cache.
+ *
+ * @param  ip   IPv6 address of the neighbor
+ * @return      the cache entry or NULL if the neighbor is not known
+ */
+struct neighbor *
+find_neighbor(ip6_addr_t *ip)
+{
+	int i;
+
+	for (i = 0; i < NDP_ENTRIES; i++) {
+		if (neighbor_cache[i].state &&
+		    !memcmp(&neighbor_cache[i].ip, ip, sizeof(ip6_addr_t)))
+			return &neighbor_cache[i];
+	}
+	return NULL;
+}
+
+/**
+ * NDP: Creates an entry (in INCOMPLETE state) for a neighbor whose MAC
+ *      address is about to be resolved.
+ *
+ * @param  ip   IPv6 address of the neighbor
+ * @return      the new cache entry
+ */
+struct neighbor *
+add_neighbor(ip6_addr_t *ip)
+{
+	struct neighbor *n = &neighbor_cache[neighbor_next];
+
+	neighbor_next = (neighbor_next + 1) % NDP_ENTRIES;
+
+	memset(n, 0, sizeof(*n));
+	memcpy(&n->ip, ip, sizeof(ip6_addr_t));
+	n->state = NB_INCOMPLETE;
+	return n;
+}
+
+/**
+ * NDP: Stores the MAC address of a neighbor (from a Neighbor Advertisement
+ *      or a link-layer address option). A packet that waits for this
+ *      address is sent now.
+ *
+ * @param  ip   IPv6 address of the neighbor
+ * @param  mac  its MAC address
+ */
+void
+update_neighbor(ip6_addr_t *ip, const uint8_t *mac)
+{
+	struct neighbor *n = find_neighbor(ip);
+
+	if (!n)
+		n = add_neighbor(ip);
+
+	memcpy(n->mac, mac, 6);
+	n->state = NB_REACHABLE;
+
+	if (n->eth_len > 0) {
+		memcpy(((struct ethhdr *) n->eth_frame)->dest_mac, mac, 6);
+		send_ether(n->eth_frame, n->eth_len);
+		n->eth_len = 0;
+	}
+}
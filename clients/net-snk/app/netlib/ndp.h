@@ -0,0 +1,45 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+#ifndef _NDP_H_
+#define _NDP_H_
+
+#include <stdint.h>
+#include <netlib/ethernet.h>
+#include <netlib/ipv6.h>
+
+/* Neighbor cache size */
+#define NDP_ENTRIES            8
+
+/* Neighbor states (RFC 4861 7.3.2, without the timer driven ones) */
+#define NB_INCOMPLETE          1
+#define NB_REACHABLE           2
+
+/** \struct neighbor
+ *  A entry that describes a mapping between IPv6- and MAC-address.
+ *  While the address is being resolved, the last packet to be sent to the
+ *  neighbor waits in eth_frame.
+ */
+struct neighbor {
+	ip6_addr_t ip;
+	uint8_t    mac[6];
+	uint8_t    state;
+	uint8_t    eth_frame[ETH_MTU_SIZE];
+	int        eth_len;
+};
+
+extern void             ndp_init(void);
+extern struct neighbor *find_neighbor(ip6_addr_t *ip);
+extern struct neighbor *add_neighbor(ip6_addr_t *ip);
+extern void             update_neighbor(ip6_addr_t *ip, const uint8_t *mac);
+
+#endif
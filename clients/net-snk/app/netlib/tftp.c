@@ -19,12 +19,13 @@
 
 #include <ethernet.h>
 #include <ipv4.h>
-//#include <ipv6.h>
+#include <ipv6.h>
 #include <udp.h>
 
 //#define __DEBUG__
 
 #define MAX_BLOCKSIZE 1428
+#define MTFTP_MAX_BLOCKS 0xffff
 #define BUFFER_LEN 2048
 #define ACK_BUFFER_LEN 256
 #define READ_BUFFER_LEN 256
@@ -62,6 +63,17 @@ static short port_number = -1;
 static tftp_err_t *tftp_err;
 static filename_ip_t  *fn_ip;
 
+/* Multicast TFTP (RFC 2090): blocks arrive in any order and are marked in
+ * mc_received; mc_next is the first block that is still missing and
+ * mc_last the final block of the file (0 as long as it is not known) */
+static int mc_mode;
+static int mc_active;
+static int mc_master;
+static unsigned int mc_next;
+static unsigned int mc_last;
+static int mc_last_len;
+static uint8_t mc_received[(MTFTP_MAX_BLOCKS + 8) / 8];
+
 /**
  * dump_package - Prints a package.
  *
@@ -85,6 +97,23 @@ dump_package(unsigned char *buffer, unsigned int len)
 }
 #endif
 
+/**
+ * fill_ip6hdr_server - Fills the IPv6 header of a packet to the server.
+ *
+ * @ip6:         IPv6 header
+ * @payload_len: length of the UDP packet
+ */
+static void
+fill_ip6hdr_server(struct ip6hdr *ip6, uint16_t payload_len)
+{
+	ip6_addr_t server_ip6;
+
+	/* fn_ip is packed, so the address is copied before it is used */
+	memcpy(&server_ip6, &fn_ip->server_ip6, sizeof(ip6_addr_t));
+	fill_ip6hdr((uint8_t *) ip6, payload_len, IPTYPE_UDP, NULL,
+		    &server_ip6);
+}
+
 /**
  * send_rrq - Sends a read request package.
  */
@@ -92,15 +121,17 @@ static void
 send_rrq(void)
 {
 	int ip_len = 0;
-	//int ip6_payload_len    = 0;
+	int ip6_payload_len    = 0;
 	unsigned short udp_len = 0;
 	unsigned char mode[] = "octet";
 	unsigned char packet[READ_BUFFER_LEN];
 	char *ptr	     = NULL;
 	struct iphdr *ip     = NULL;
-	//struct ip6hdr *ip6   = NULL;
+	struct ip6hdr *ip6   = NULL;
 	struct udphdr *udph  = NULL;
 	struct tftphdr *tftp = NULL;
+	/* "multicast" option with an empty value */
+	int mc_len = mc_mode ? strlen("multicast") + 2 : 0;
 
 	memset(packet, 0, READ_BUFFER_LEN);
 
@@ -109,26 +140,23 @@ send_rrq(void)
 		udph = (struct udphdr *) (ip + 1);
 		ip_len = sizeof(struct iphdr) + sizeof(struct udphdr)
 			+ strlen((char *) fn_ip->filename) + strlen((char *) mode) + 4
-			+ strlen("blksize") + strlen(blocksize_str) + 2;
+			+ strlen("blksize") + strlen(blocksize_str) + 2 + mc_len;
 		fill_iphdr ((uint8_t *) ip, ip_len, IPTYPE_UDP, 0,
 			    fn_ip->server_ip);
 	}
-/*
 	else if (6 == ip_version) {
 		ip6 = (struct ip6hdr *) packet;
 		udph = (struct udphdr *) (ip6 + 1);
 		ip6_payload_len = sizeof(struct udphdr)
 			+ strlen((char *) fn_ip->filename) + strlen((char *) mode) + 4
-			+ strlen("blksize") + strlen(blocksize_str) + 2;
+			+ strlen("blksize") + strlen(blocksize_str) + 2 + mc_len;
 		ip_len = sizeof(struct ip6hdr) + ip6_payload_len;
-		fill_ip6hdr ((uint8_t *) ip6, ip6_payload_len, IPTYPE_UDP, get_ipv6_address(),
-			     &(fn_ip->server_ip6)); 
+		fill_ip6hdr_server(ip6, ip6_payload_len);
 
 	}
-*/
 	udp_len = htons(sizeof(struct udphdr)
 			      + strlen((char *) fn_ip->filename) + strlen((char *) mode) + 4
-			      + strlen("blksize") + strlen(blocksize_str) + 2);
+			      + strlen("blksize") + strlen(blocksize_str) + 2 + mc_len);
 	fill_udphdr ((uint8_t *) udph, udp_len, htons(2001), htons(69));
 
 	tftp = (struct tftphdr *) (udph + 1);
@@ -146,6 +174,12 @@ send_rrq(void)
 	ptr += strlen("blksize") + 1;
 	memcpy(ptr, blocksize_str, strlen(blocksize_str) + 1);
 
+	if (mc_mode) {
+		/* the empty value is already there, packet has been cleared */
+		ptr += strlen(blocksize_str) + 1;
+		memcpy(ptr, "multicast", strlen("multicast") + 1);
+	}
+
 	send_ip (packet, ip_len);
 
 #ifdef __DEBUG__
@@ -164,11 +198,11 @@ static void
 send_ack(int blckno, unsigned short dport)
 {
 	int ip_len 	       = 0;
-	//int ip6_payload_len    = 0;
+	int ip6_payload_len    = 0;
 	unsigned short udp_len = 0;
 	unsigned char packet[ACK_BUFFER_LEN];
 	struct iphdr *ip     = NULL;
-	//struct ip6hdr *ip6   = NULL;
+	struct ip6hdr *ip6   = NULL;
 	struct udphdr *udph  = NULL;
 	struct tftphdr *tftp = NULL;
 
@@ -181,17 +215,13 @@ send_ack(int blckno, unsigned short dport)
 		fill_iphdr ((uint8_t *) ip, ip_len, IPTYPE_UDP, 0,
 			    fn_ip->server_ip);
 	}
-/*
 	else if (6 == ip_version) {
 		ip6 = (struct ip6hdr *) packet;
 		udph = (struct udphdr *) (ip6 + 1);
 		ip6_payload_len = sizeof(struct udphdr) + 4;
-		ip_len = sizeof(struct ethhdr) + sizeof(struct ip6hdr) +
-		    	 ip6_payload_len;
-		fill_ip6hdr ((uint8_t *) ip6, ip6_payload_len, IPTYPE_UDP, get_ipv6_address(),
-			     &(fn_ip->server_ip6));
+		ip_len = sizeof(struct ip6hdr) + ip6_payload_len;
+		fill_ip6hdr_server(ip6, ip6_payload_len);
 	}
-*/
 	udp_len = htons(sizeof(struct udphdr) + 4);
 	fill_udphdr ((uint8_t *) udph, udp_len, htons(2001), htons(dport));
 
@@ -218,10 +248,10 @@ static void
 send_error(int error_code, unsigned short dport)
 {
 	int ip_len 	       = 0;
-	//int ip6_payload_len    = 0;
+	int ip6_payload_len    = 0;
 	unsigned short udp_len = 0;
 	unsigned char packet[256];
-	//struct ip6hdr *ip6   = NULL;
+	struct ip6hdr *ip6   = NULL;
 	struct iphdr *ip     = NULL;
 	struct udphdr *udph  = NULL;
 	struct tftphdr *tftp = NULL;
@@ -235,17 +265,13 @@ send_error(int error_code, unsigned short dport)
 		fill_iphdr ((uint8_t *) ip, ip_len, IPTYPE_UDP, 0,
 			    fn_ip->server_ip);
 	}
-/*
 	else if (6 == ip_version) {
 		ip6 = (struct ip6hdr *) packet;
 		udph = (struct udphdr *) (ip6 + 1);
 		ip6_payload_len = sizeof(struct udphdr) + 5;
-		ip_len = sizeof(struct ethhdr) + sizeof(struct ip6hdr) +
-		         ip6_payload_len; 
-		fill_ip6hdr ((uint8_t *) ip6, ip6_payload_len, IPTYPE_UDP, get_ipv6_address(),
-			    &(fn_ip->server_ip6));
+		ip_len = sizeof(struct ip6hdr) + ip6_payload_len;
+		fill_ip6hdr_server(ip6, ip6_payload_len);
 	}
-*/
 	udp_len = htons(sizeof(struct udphdr) + 5);
 	fill_udphdr ((uint8_t *) udph, udp_len, htons(2001), htons(dport));
 
@@ -290,8 +316,8 @@ print_progress(int urgent, int received_bytes)
 }
 
 /**
- * get_blksize tries to extract the blksize from the OACK package
- * the TFTP returned. From RFC 1782
+ * get_option tries to extract the value of an option from the OACK
+ * package the TFTP returned. From RFC 1782
  * The OACK packet has the following format:
  *
  *   +-------+---~~---+---+---~~---+---+---~~---+---+---~~---+---+
@@ -300,10 +326,11 @@ print_progress(int urgent, int received_bytes)
  *
  * @param buffer  the network packet
  * @param len  the length of the network packet
- * @return  the blocksize the server supports or 0 for error
+ * @param name  the name of the option
+ * @return  the value of the option or NULL if it is not present
  */
-static int
-get_blksize(unsigned char *buffer, unsigned int len)
+static char *
+get_option(unsigned char *buffer, unsigned int len, const char *name)
 {
 	unsigned char *orig = buffer;
 	/* skip all headers until tftp has been reached */
@@ -311,10 +338,8 @@ get_blksize(unsigned char *buffer, unsigned int len)
 	/* skip opc */
 	buffer += 2;
 	while (buffer < orig + len) {
-		if (!memcmp(buffer, "blksize", strlen("blksize") + 1))
-			return (unsigned short) strtoul((char *) (buffer +
-							strlen("blksize") + 1),
-							(char **) NULL, 10);
+		if (!memcmp(buffer, name, strlen(name) + 1))
+			return (char *) (buffer + strlen(name) + 1);
 		else {
 			/* skip the option name */
 			buffer = (unsigned char *) strchr((char *) buffer, 0);
@@ -324,10 +349,154 @@ get_blksize(unsigned char *buffer, unsigned int len)
 			/* skip the option value */
 			buffer = (unsigned char *) strchr((char *) buffer, 0);
 			if (!buffer)
-				return 0;
+				return NULL;
 			buffer++;
 		}
 	}
+	return NULL;
+}
+
+/**
+ * get_blksize tries to extract the blksize from the OACK package
+ *
+ * @param buffer  the network packet
+ * @param len  the length of the network packet
+ * @return  the blocksize the server supports or 0 for error
+ */
+static int
+get_blksize(unsigned char *buffer, unsigned int len)
+{
+	char *value = get_option(buffer, len, "blksize");
+
+	if (!value)
+		return 0;
+	return (unsigned short) strtoul(value, (char **) NULL, 10);
+}
+
+/**
+ * mtftp_join evaluates the "multicast" option of an OACK (RFC 2090),
+ * which has the format "addr,port,mc". Address and port may be left out
+ * in OACKs that only change the master client.
+ * Joining the group announces it with an IGMPv2 membership report (see
+ * set_ipv4_multicast), without which switches that snoop IGMP do not
+ * forward the group to us.
+ *
+ * @param buffer  the network packet
+ * @param len  the length of the network packet
+ * @return  NON ZERO if the file is sent to a multicast group
+ */
+static int
+mtftp_join(unsigned char *buffer, unsigned int len)
+{
+	char *value = get_option(buffer, len, "multicast");
+	uint32_t group = 0;
+	unsigned long port;
+	int i;
+
+	if (!value)
+		return 0;
+
+	if (*value != ',') {
+		for (i = 0; i < 4; i++) {
+			group = (group << 8) | strtoul(value, &value, 10);
+			if (*value != (i < 3 ? '.' : ','))
+				return 0;
+			value++;
+		}
+	}
+	else
+		value++;
+
+	port = strtoul(value, &value, 10);
+	if (*value != ',')
+		return 0;
+	value++;
+
+	if (group) {
+		if (!port)
+			return 0;
+		set_ipv4_multicast(group);
+		if (!get_ipv4_multicast())
+			return 0;
+		net_set_mtftp_port(port);
+	}
+	else if (!mc_active)
+		return 0;
+
+	mc_active = 1;
+	mc_master = (*value == '1');
+	return 1;
+}
+
+/**
+ * mtftp_leave stops receiving packets sent to the multicast group.
+ */
+static void
+mtftp_leave(void)
+{
+	if (mc_active) {
+		set_ipv4_multicast(0);
+		net_set_mtftp_port(0);
+	}
+	mc_active = 0;
+	mc_master = 0;
+}
+
+/**
+ * mtftp_data stores a DATA packet of a multicast transfer. The blocks may
+ * arrive in any order; only the master client sends ACKs, always for the
+ * block before the first missing one, so that the server continues there.
+ *
+ * @param udph  the UDP header of the packet
+ * @param tftp  the TFTP header of the packet
+ * @return  ZERO if the packet was handled, otherwise the error code
+ */
+static int
+mtftp_data(struct udphdr *udph, struct tftphdr *tftp)
+{
+	unsigned short blk = tftp->th_data;
+	int data_len = udph->uh_ulen - 12;
+	int offset = (blk - 1) * blocksize;
+
+	if (blk == 0 || data_len < 0 || data_len > blocksize) {
+		tftp_err->bad_tftp_packets++;
+		return 0;
+	}
+
+	if (mc_received[blk >> 3] & (1 << (blk & 7))) {
+		/* a block we already have, resent for another client */
+		if (mc_master && blk < mc_next)
+			send_ack(mc_next - 1, port_number);
+		return 0;
+	}
+
+	tftp_err->bad_tftp_packets = 0;
+	if (offset + data_len > len)
+		return -2;
+	if (blk == MTFTP_MAX_BLOCKS && data_len == blocksize)
+		return -9;
+
+	memcpy(buffer + offset, &tftp->th_data + 1, data_len);
+	mc_received[blk >> 3] |= 1 << (blk & 7);
+	received_len += data_len;
+
+	/* Last packet reached if the payload is smaller than blocksize */
+	if (data_len < blocksize) {
+		mc_last = blk;
+		mc_last_len = data_len;
+	}
+
+	while (mc_next <= MTFTP_MAX_BLOCKS
+	       && (mc_received[mc_next >> 3] & (1 << (mc_next & 7))))
+		++mc_next;
+
+	if (mc_master)
+		send_ack(mc_next - 1, port_number);
+
+	if (mc_last && mc_next > mc_last) {
+		received_len = (mc_last - 1) * blocksize + mc_last_len;
+		tftp_finished = 1;
+	}
 	return 0;
 }
 
@@ -368,19 +537,33 @@ handle_tftp(uint8_t *packet, int32_t packetsize)
 
 	port_number = udph->uh_sport;
 	if (tftp->th_opcode == htons(OACK)) {
-		/* an OACK means that the server answers our blocksize request */
-		blocksize = get_blksize(packet, packetsize);
+		/* an OACK means that the server answers our blocksize request;
+		 * OACKs during a multicast transfer may leave it out */
+		if (!mc_active || get_blksize(packet, packetsize))
+			blocksize = get_blksize(packet, packetsize);
 		if (!blocksize || blocksize > MAX_BLOCKSIZE) {
 			send_error(8, port_number);
 			tftp_errno = -8;
 			goto error;
 		}
+		if (mc_mode) {
+			if (mtftp_join(packet, packetsize)) {
+				/* the master client asks for its first missing
+				 * block, all others just listen */
+				if (mc_master)
+					send_ack(mc_next - 1, port_number);
+				return 0;
+			}
+			/* no multicast support - continue with unicast */
+			mc_mode = 0;
+		}
 		send_ack(0, port_number);
 	} else if (tftp->th_opcode == htons(ACK)) {
 		/* an ACK means that the server did not answers
 		 * our blocksize request, therefore we will set the blocksize
 		 * to the default value of 512 */
 		blocksize = 512;
+		mc_mode = 0;
 		send_ack(0, port_number);
 	} else if ((unsigned char) tftp->th_opcode == ERROR) {
 #ifdef __DEBUG__
@@ -407,8 +590,13 @@ handle_tftp(uint8_t *packet, int32_t packetsize)
 			tftp_errno = -1;	// ERROR: unknown error
 		}
 		goto error;
+	} else if (tftp->th_opcode == DATA && mc_active) {
+		tftp_errno = mtftp_data(udph, tftp);
+		if (tftp_errno)
+			goto error;
 	} else if (tftp->th_opcode == DATA) {
 		/* DATA PACKAGE */
+		mc_mode = 0;
 		if (block + 1 == tftp->th_data) {
 			++block;
 		}
@@ -511,7 +699,9 @@ handle_tftp_dun(uint8_t err_code)
  * @param  _len          size of destination buffer
  * @param  _retries      max number of retries
  * @param  _tftp_err     contains info about TFTP-errors (e.g. lost packets)
- * @param  _mode         NON ZERO - multicast, ZERO - unicast
+ * @param  _mode         TFTP_MODE_HUGE - allow files with more than
+ *                       0xffff blocks, TFTP_MODE_MULTICAST - ask for a
+ *                       multicast transfer (RFC 2090)
  * @param  _blocksize    blocksize for DATA-packets
  * @return               ZERO - error condition occurs
  *                       NON ZERO - size of received file
@@ -524,7 +714,7 @@ tftp(filename_ip_t * _fn_ip, unsigned char *_buffer, int _len,
 	retries     = _retries;
 	fn_ip       = _fn_ip;
 	len         = _len;
-	huge_load   = _mode;
+	huge_load   = _mode & TFTP_MODE_HUGE;
 	ip_version  = _ip_version;
 	tftp_errno  = 0;
 	tftp_err    = _tftp_err;
@@ -542,6 +732,15 @@ tftp(filename_ip_t * _fn_ip, unsigned char *_buffer, int _len,
 		_blocksize = MAX_BLOCKSIZE;
 	sprintf(blocksize_str, "%d", _blocksize);
 
+	/* RFC 2090 only defines multicast groups for IPv4 */
+	mc_mode = (_mode & TFTP_MODE_MULTICAST) && ip_version == 4;
+	mc_active = 0;
+	mc_master = 0;
+	mc_next = 1;
+	mc_last = 0;
+	if (mc_mode)
+		memset(mc_received, 0, sizeof(mc_received));
+
 	printf("  Receiving data:  ");
 	print_progress(-1, 0);
 
@@ -554,8 +753,17 @@ tftp(filename_ip_t * _fn_ip, unsigned char *_buffer, int _len,
 	while (! tftp_finished) {
 		/* if timeout (no packet received) */
 		if(get_timer() <= 0) {
+			/* in a multicast transfer, the master asks for the
+			 * missing blocks again; the other clients repeat their
+			 * request, so that the server makes them master later */
+			if (mc_active) {
+				if (mc_master)
+					send_ack(mc_next - 1, port_number);
+				else if ((tftp_err->no_packets & 3) == 3)
+					send_rrq();
+			}
 			/* the server doesn't seem to retry let's help out a bit */
-			if (tftp_err->no_packets > 4 && port_number != -1
+			else if (tftp_err->no_packets > 4 && port_number != -1
 			    && block > 1) {
 				send_ack(block, port_number);
 			}
@@ -590,6 +798,7 @@ tftp(filename_ip_t * _fn_ip, unsigned char *_buffer, int _len,
 
 	// Setting buffer to NULL disables handling of received TFTP packets.
 	buffer = NULL;
+	mtftp_leave();
 
 	if (tftp_errno)
 		return tftp_errno;
@@ -15,7 +15,7 @@
 #define _TFTP_H_
 
 #include <stdint.h>
-//#include <netlib/ipv6.h>
+#include <netlib/ipv6.h>
 
 struct tftphdr {
 	int16_t th_opcode;
@@ -24,12 +24,16 @@ struct tftphdr {
 
 typedef struct {
 	uint32_t own_ip;
-	//ip6_addr_t own_ip6;
+	ip6_addr_t own_ip6;
 	uint32_t server_ip;
-	//ip6_addr_t server_ip6;
+	ip6_addr_t server_ip6;
 	int8_t filename[256];
 } __attribute__ ((packed)) filename_ip_t ;
 
+/* Flags for the mode argument of tftp() */
+#define TFTP_MODE_HUGE       1   /**< more than 0xffff blocks (wrap around) */
+#define TFTP_MODE_MULTICAST  2   /**< multicast transfer (RFC 2090)         */
+
 typedef struct {
 	uint32_t bad_tftp_packets;
 	uint32_t no_packets;
@@ -15,7 +15,7 @@
 #include <udp.h>
 #include <sys/socket.h>
 #include <dhcp.h>
-//#include <dhcpv6.h>
+#include <dhcpv6.h>
 #include <dns.h>
 #ifdef USE_MTFTP
 #include <mtftp.h>
@@ -28,19 +28,20 @@
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> LOCAL VARIABLES <<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 
+uint16_t net_mtftp_uport;
+
+void net_set_mtftp_port(uint16_t tftp_port) {
+	net_mtftp_uport = tftp_port;
+}
+
 #ifdef USE_MTFTP
 
 uint16_t net_tftp_uport;
-uint16_t net_mtftp_uport;
 
 void net_set_tftp_port(uint16_t tftp_port) {
 	net_tftp_uport = tftp_port;
 }
 
-void net_set_mtftp_port(uint16_t tftp_port) {
-	net_mtftp_uport = tftp_port;
-}
-
 #endif
 
 /*>>>>>>>>>>>>>>>>>>>>>>>>>>>>> IMPLEMENTATION <<<<<<<<<<<<<<<<<<<<<<<<<<*/
@@ -76,11 +77,12 @@ handle_udp(uint8_t * udp_packet, int32_t packetsize) {
 			                  packetsize - sizeof(struct udphdr));
 		else
 			return -1;
-/*
-        case UDPPORT_DHCPV6C:
-                return handle_dhcpv6(udp_packet+sizeof(struct udphdr),
-                                     packetsize - sizeof(struct udphdr));
-*/
+	case UDPPORT_DHCPV6C:
+		if (udph -> uh_sport == htons(UDPPORT_DHCPV6S))
+			return handle_dhcpv6(udp_packet + sizeof(struct udphdr),
+			                     packetsize - sizeof(struct udphdr));
+		else
+			return -1;
 	case UDPPORT_TFTPC:
 #ifdef USE_MTFTP
 	return handle_tftp(udp_packet + sizeof(struct udphdr),
@@ -96,6 +98,10 @@ handle_udp(uint8_t * udp_packet, int32_t packetsize) {
 		else if (htons(udph -> uh_dport) == net_mtftp_uport)
 		return handle_tftp(udp_packet + sizeof(struct udphdr),
                        packetsize - sizeof(struct udphdr));
+#else
+		/* multicast TFTP data (RFC 2090) arrives at the group port */
+		if (net_mtftp_uport && htons(udph -> uh_dport) == net_mtftp_uport)
+			return handle_tftp(udp_packet, packetsize);
 #endif
 		return -1;
 	}
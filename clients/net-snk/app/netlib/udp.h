@@ -23,6 +23,7 @@
 #define UDPPORT_DNSC    32769   /**< UDP port of DNS-client        */
 #define UDPPORT_TFTPC    2001   /**< UDP port of TFTP-client	   */
 #define UDPPORT_DHCPV6C   546   /**< UDP port of DHCPv6-client     */
+#define UDPPORT_DHCPV6S   547   /**< UDP port of DHCPv6-server     */
 
 /** \struct udphdr
  *  A header for UDP-packets.
@@ -50,9 +51,9 @@ extern void handle_udp_dun(uint8_t * udp_packet, uint32_t packetsize, uint8_t er
 extern void fill_udphdr(uint8_t *packet, uint16_t packetsize,
                         uint16_t src_port, uint16_t dest_port);
 
+extern void net_set_mtftp_port(uint16_t tftp_port);
 #ifdef USE_MTFTP
 extern void net_set_tftp_port(uint16_t tftp_port);
-extern void net_set_mtftp_port(uint16_t tftp_port);
 #endif
 
 #endif
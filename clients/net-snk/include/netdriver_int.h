@@ -161,6 +161,7 @@ snk_module_t *module_init(snk_kernel_t * snk_kernel_int,
 #define ETHTOOL_GMAC         0x03
 #define ETHTOOL_SMAC         0x04
 #define ETHTOOL_VERSION      0x05
+#define ETHTOOL_STXCSUM      0x17
 
 typedef struct {
 	int idx;
@@ -172,6 +173,10 @@ typedef struct {
 	char *text;
 } ioctl_ethtool_version_t;
 
+typedef struct {
+	int enable;
+} ioctl_ethtool_csum_t;
+
 
 /*
  * default structure and constants for IOCTL requests
@@ -185,6 +190,7 @@ typedef struct {
 	union {
 		ioctl_ethtool_mac_t mac;
 		ioctl_ethtool_version_t version;
+		ioctl_ethtool_csum_t csum;
 	} data;
 } ioctl_net_data_t;
 
@@ -54,6 +54,8 @@ void * of_set_callback(void *);
 unsigned int romfs_lookup(const char *, void **);
 int vpd_read(unsigned int , unsigned int , char *);
 int vpd_write(unsigned int , unsigned int , char *);
+int dhcp_cache_read(char *, unsigned int);
+int dhcp_cache_write(char *, unsigned int);
 int write_mm_log(char *, unsigned int , unsigned short );
 
 void get_mac(char *mac);
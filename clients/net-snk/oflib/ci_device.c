@@ -120,7 +120,21 @@ cimod_write(char *buffer, int len)
 static int
 cimod_ioctl(int request, void *data)
 {
+	ioctl_net_data_t *ioctl_data = (ioctl_net_data_t *) data;
+
 	dprintf("cimod ioctl called!\n");
 
+	if (request != SIOCETHTOOL)
+		return 0;
+
+	switch (ioctl_data->subcmd) {
+	case ETHTOOL_STXCSUM:
+		/* Only supported if the driver provides "set-tx-csum" */
+		if (!of_call_method_3("set-tx-csum", myself,
+		                      ioctl_data->data.csum.enable))
+			return -1;
+		break;
+	}
+
 	return 0;
 }
@@ -343,6 +343,20 @@ vpd_write(unsigned int offset, unsigned int length, char *data)
 	return result;
 }
 
+int
+dhcp_cache_read(char *data, unsigned int length)
+{
+	long tmp = (long) data;
+	return of_2_1("ibm,dhcp-cache-read", (int) tmp, length);
+}
+
+int
+dhcp_cache_write(char *data, unsigned int length)
+{
+	long tmp = (long) data;
+	return of_2_1("ibm,dhcp-cache-write", (int) tmp, length);
+}
+
 static void
 ipmi_oem_led_set(int type, int instance, int state)
 {
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*
+ * CRC-32 of the flash image (generator 0x04C11DB7, most significant bit
+ * first, no pre- or post-inversion), see calculatecrc.h.
+ *
+ * The "slicing-by-8" method is used: crc32_table[k][i] is the CRC of byte i
+ * followed by k zero bytes, so eight input bytes are folded into the CRC
+ * with eight independent table lookups instead of 64 shift/xor steps.
+ *
+ * This file and llfw/crc32.c are used by build_romfs on the host as well
+ * as by the firmware, so they do not depend on anything but <stdint.h>.
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+#define CRC32_GENERATOR	0x04C11DB7
+
+extern uint32_t crc32_table[8][256];
+
+/* fill crc32_table, crc32_update() does this on its first call */
+extern void crc32_init(void);
+
+/* add one byte to the CRC */
+static inline uint32_t
+crc32_update8(uint32_t crc, uint8_t val)
+{
+	return (crc << 8) ^ crc32_table[0][(crc >> 24) ^ val];
+}
+
+/* add eight bytes to the CRC; the first byte is the most significant one */
+static inline uint32_t
+crc32_update64(uint32_t crc, uint64_t val)
+{
+	uint32_t hi = (uint32_t) (val >> 32) ^ crc;
+	uint32_t lo = (uint32_t) val;
+
+	return crc32_table[7][hi >> 24] ^ crc32_table[6][(hi >> 16) & 0xff] ^
+	    crc32_table[5][(hi >> 8) & 0xff] ^ crc32_table[4][hi & 0xff] ^
+	    crc32_table[3][lo >> 24] ^ crc32_table[2][(lo >> 16) & 0xff] ^
+	    crc32_table[1][(lo >> 8) & 0xff] ^ crc32_table[0][lo & 0xff];
+}
+
+/* add len bytes from buf to the CRC */
+extern uint32_t crc32_update(uint32_t crc, const unsigned char *buf,
+			     unsigned long len);
+
+#endif /* CRC32_H */
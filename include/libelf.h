@@ -72,6 +72,16 @@ int elf_load_file_to_addr(void *file_addr, void *addr, unsigned long *entry,
                           int (*pre_load)(void*, long),
                           void (*post_load)(void*, long));
 
+/* largest header block elf_load_stream() looks at */
+#define ELF_STREAM_HDR_SIZE	0x1000
+
+int elf_load_stream(void *hdr, long hdr_len, unsigned long *entry,
+                    long (*read)(void*, unsigned long, long),
+                    int (*pre_load)(void*, long),
+                    void (*post_load)(void*, long));
+int elf_read_all(long (*read)(void*, unsigned long, long), void *dest,
+                 unsigned long offset, long len);
+
 unsigned int elf_load_segments32(void *file_addr, signed long offset,
                                  int (*pre_load)(void*, long),
                                  void (*post_load)(void*, long));
@@ -79,6 +89,15 @@ unsigned long elf_load_segments64(void *file_addr, signed long offset,
                                   int (*pre_load)(void*, long),
                                   void (*post_load)(void*, long));
 
+int elf_stream_segments32(void *hdr, long hdr_len, unsigned long *entry,
+                          long (*read)(void*, unsigned long, long),
+                          int (*pre_load)(void*, long),
+                          void (*post_load)(void*, long));
+int elf_stream_segments64(void *hdr, long hdr_len, unsigned long *entry,
+                          long (*read)(void*, unsigned long, long),
+                          int (*pre_load)(void*, long),
+                          void (*post_load)(void*, long));
+
 long elf_get_base_addr(void *file_addr);
 long elf_get_base_addr32(void *file_addr);
 long elf_get_base_addr64(void *file_addr);
@@ -86,5 +105,6 @@ long elf_get_base_addr64(void *file_addr);
 void elf_relocate64(void *file_addr, signed long offset);
 
 int elf_forth_claim(void *addr, long size);
+long elf_forth_read(void *dest, unsigned long offset, long len);
 
 #endif				/* __LIBELF_H */
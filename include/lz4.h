@@ -0,0 +1,19 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+#ifndef _LZ4_H
+#define _LZ4_H
+
+extern long lz4_decompress(const void *src, unsigned long srclen,
+			   void *dest, unsigned long destlen);
+
+#endif /* _LZ4_H */
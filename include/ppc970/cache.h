@@ -83,4 +83,81 @@ cache_inhibited_access(uint64_t, 64)
 		default:		_RMOVE(s, d, size, type_c); break; \
 	}
 
+/*
+ * Sum of all bytes of a block, used to verify copies from device memory.
+ * ci_rom_checksum reads the device cache-inhibited, ram_checksum reads
+ * normal memory; both give the same result for the same contents.
+ */
+static inline uint64_t sum_bytes64(uint64_t v)
+{
+	v = (v & 0x00ff00ff00ff00ffULL) + ((v >> 8) & 0x00ff00ff00ff00ffULL);
+	return (v * 0x0001000100010001ULL) >> 48;
+}
+
+static inline uint64_t ci_rom_checksum(const void *src, unsigned long size)
+{
+	uint8_t *s = (uint8_t *)src;
+	uint64_t sum = 0;
+
+	if (((unsigned long)s & 7) == 0)
+		for (; size >= 8; size -= 8, s += 8)
+			sum += sum_bytes64(ci_read_64((uint64_t *)s));
+	for (; size > 0; size--)
+		sum += ci_read_8(s++);
+	return sum;
+}
+
+static inline uint64_t ram_checksum(const void *buf, unsigned long size)
+{
+	const uint8_t *s = buf;
+	uint64_t sum = 0;
+
+	if (((unsigned long)s & 7) == 0)
+		for (; size >= 8; size -= 8, s += 8)
+			sum += sum_bytes64(*(const uint64_t *)s);
+	for (; size > 0; size--)
+		sum += *s++;
+	return sum;
+}
+
+/*
+ * Copy device memory (e.g. an expansion ROM) to normal RAM. Only the loads
+ * are cache-inhibited, the RAM is written through the cache. Four aligned
+ * doublewords are loaded per cache-inhibited section, so HID4 does not
+ * have to be switched for every single byte.
+ * Switching to cache-inhibited mode sometimes loses bytes, so the copy is
+ * verified by reading the device a second time. Returns 0 if it matches.
+ */
+static inline int ci_rom_copy(void *dst, const void *src, unsigned long size)
+{
+	uint8_t *d = dst;
+	uint8_t *s = (uint8_t *)src;
+	unsigned long len = size;
+	uint64_t v0, v1, v2, v3;
+
+	if ((((unsigned long)d | (unsigned long)s) & 7) == 0) {
+		for (; size >= 32; size -= 32, s += 32, d += 32) {
+			set_ci();
+			v0 = ((volatile uint64_t *)s)[0];
+			v1 = ((volatile uint64_t *)s)[1];
+			v2 = ((volatile uint64_t *)s)[2];
+			v3 = ((volatile uint64_t *)s)[3];
+			clr_ci();
+			((uint64_t *)d)[0] = v0;
+			((uint64_t *)d)[1] = v1;
+			((uint64_t *)d)[2] = v2;
+			((uint64_t *)d)[3] = v3;
+		}
+		for (; size >= 8; size -= 8, s += 8, d += 8)
+			*(uint64_t *)d = ci_read_64((uint64_t *)s);
+	} else if ((((unsigned long)d | (unsigned long)s) & 3) == 0) {
+		for (; size >= 4; size -= 4, s += 4, d += 4)
+			*(uint32_t *)d = ci_read_32((uint32_t *)s);
+	}
+	for (; size > 0; size--)
+		*d++ = ci_read_8(s++);
+
+	return ci_rom_checksum(src, len) != ram_checksum(dst, len);
+}
+
 #endif
@@ -86,7 +86,7 @@ cache_inhibited_access(uint64_t, 64)
 	default:		_MOVE(s, d, size, type_c); break;	\
 	}
 
-static inline void ci_rmove(void *dst, void *src, unsigned long esize,
+static inline long ci_rmove(void *dst, void *src, unsigned long esize,
 			    unsigned long count)
 {
 	register uint64_t arg0 asm ("r3");
@@ -111,6 +111,7 @@ static inline void ci_rmove(void *dst, void *src, unsigned long esize,
 		     : "r0", "r9", "r10", "r11",
 		       "r12", "memory", "cr0", "cr1", "cr5",
 		       "cr6", "cr7", "ctr", "xer");
+	return arg0;
 }
 
 #define _FASTRMOVE(s, d, size) do {					      \
@@ -146,5 +147,26 @@ static inline void bswap32_store(uint64_t addr, uint32_t val)
 	asm volatile ("stwbrx %0, 0, %1"::"r" (val), "r"(addr));
 }
 
+/*
+ * Copy device memory (e.g. an expansion ROM) to normal RAM, with the
+ * widest access the alignment allows. The copy is done by the hypervisor
+ * in one call, so unlike on ppc970 no bytes can get lost on the way and
+ * the device is not read a second time. Returns 0 if the copy succeeded.
+ */
+static inline int ci_rom_copy(void *dst, const void *src, unsigned long size)
+{
+	switch (((unsigned long)dst | (unsigned long)src | size) & 7) {
+	case 0:
+		return ci_rmove(dst, (void *)src, 3, size >> 3) != 0;
+	case 4:
+		return ci_rmove(dst, (void *)src, 2, size >> 2) != 0;
+	case 2:
+	case 6:
+		return ci_rmove(dst, (void *)src, 1, size >> 1) != 0;
+	default:
+		return ci_rmove(dst, (void *)src, 0, size) != 0;
+	}
+}
+
 #endif /* __CACHE_H */
 
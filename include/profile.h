@@ -0,0 +1,39 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+/* Sort keys for SLOF_profile_sort() */
+#define PROFILE_BY_COUNT	0
+#define PROFILE_BY_TICKS	1
+
+struct profile_entry {
+	void *xt;
+	unsigned long count;
+	unsigned long ticks;
+};
+
+extern int profile_enabled;
+
+extern void SLOF_profile_hit(void *xt);
+extern void SLOF_profile_reset(void);
+extern long SLOF_profile_sort(int key);
+extern struct profile_entry *SLOF_profile_entry(long n);
+
+#ifdef ENGINE_PROFILE
+#define PROFILE_HIT(xt)	do { if (profile_enabled) SLOF_profile_hit(xt); } while (0)
+#else
+#define PROFILE_HIT(xt)	do { } while (0)
+#endif
+
+#endif /* _PROFILE_H */
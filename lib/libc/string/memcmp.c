@@ -10,6 +10,7 @@
  *     IBM Corporation - initial implementation
  *****************************************************************************/
 
+#include "stdint.h"
 #include "string.h"
 
 
@@ -19,6 +20,22 @@ memcmp(const void *ptr1, const void *ptr2, size_t n)
 	const unsigned char *p1 = ptr1;
 	const unsigned char *p2 = ptr2;
 
+	/* Skip over equal words if both can be aligned together */
+	if (n >= 16 && (((unsigned long)p1 ^ (unsigned long)p2) & 7) == 0) {
+		while ((unsigned long)p1 & 7) {
+			if (*p1 != *p2)
+				return (*p1 - *p2);
+			p1 += 1;
+			p2 += 1;
+			n--;
+		}
+		while (n >= 8 && *(const uint64_t *)p1 == *(const uint64_t *)p2) {
+			p1 += 8;
+			p2 += 8;
+			n -= 8;
+		}
+	}
+
 	while (n-- > 0) {
 		if (*p1 != *p2)
 			return (*p1 - *p2);
@@ -10,6 +10,7 @@
  *     IBM Corporation - initial implementation
  *****************************************************************************/
 
+#include "stdint.h"
 #include "string.h"
 
 void *
@@ -17,8 +18,59 @@ memcpy(void *dest, const void *src, size_t n)
 {
 	char *cdest;
 	const char *csrc = src;
+	uint64_t *ldest;
+	const uint64_t *lsrc;
+	uint64_t cur, next;
+	unsigned int shift;
 
 	cdest = dest;
+
+	if (n >= 16) {
+		/* Copy the head bytewise until the destination is aligned */
+		while ((unsigned long)cdest & 7) {
+			*cdest++ = *csrc++;
+			n--;
+		}
+		ldest = (uint64_t *)cdest;
+		shift = ((unsigned long)csrc & 7) * 8;
+		lsrc = (const uint64_t *)(csrc - shift / 8);
+
+		if (!shift) {
+			while (n >= 32) {
+				ldest[0] = lsrc[0];
+				ldest[1] = lsrc[1];
+				ldest[2] = lsrc[2];
+				ldest[3] = lsrc[3];
+				ldest += 4;
+				lsrc += 4;
+				n -= 32;
+			}
+			while (n >= 8) {
+				*ldest++ = *lsrc++;
+				n -= 8;
+			}
+			csrc = (const char *)lsrc;
+		} else {
+			/* Source is misaligned: only do aligned loads and
+			 * merge two source words into each destination word.
+			 * Every load contains at least one byte that is part
+			 * of the source, so we never touch a foreign page. */
+			cur = *lsrc++;
+			while (n >= 8) {
+				next = *lsrc++;
+#ifdef __BIG_ENDIAN__
+				*ldest++ = (cur << shift) | (next >> (64 - shift));
+#else
+				*ldest++ = (cur >> shift) | (next << (64 - shift));
+#endif
+				cur = next;
+				csrc += 8;
+				n -= 8;
+			}
+		}
+		cdest = (char *)ldest;
+	}
+
 	while (n-- > 0) {
 		*cdest++ = *csrc++;
 	}
@@ -10,6 +10,7 @@
  *     IBM Corporation - initial implementation
  *****************************************************************************/
 
+#include "stdint.h"
 #include "string.h"
 
 
@@ -18,25 +19,59 @@ memmove(void *dest, const void *src, size_t n)
 {
 	char *cdest;
 	const char *csrc;
-	int i;
+	uint64_t *ldest;
+	const uint64_t *lsrc;
 
 	/* Do the buffers overlap in a bad way? */
-	if (src < dest && src + n >= dest) {
+	if (src < dest && src + n > dest) {
 		/* Copy from end to start */
-		cdest = dest + n - 1;
-		csrc = src + n - 1;
-		for (i = 0; i < n; i++) {
-			*cdest-- = *csrc--;
+		cdest = dest + n;
+		csrc = src + n;
+		if (n >= 16 && (((unsigned long)cdest ^ (unsigned long)csrc) & 7) == 0) {
+			while ((unsigned long)cdest & 7) {
+				*--cdest = *--csrc;
+				n--;
+			}
+			ldest = (uint64_t *)cdest;
+			lsrc = (const uint64_t *)csrc;
+			while (n >= 8) {
+				*--ldest = *--lsrc;
+				n -= 8;
+			}
+			cdest = (char *)ldest;
+			csrc = (const char *)lsrc;
+		}
+		while (n-- > 0) {
+			*--cdest = *--csrc;
 		}
 	}
-	else {
-		/* Normal copy is possible */
+	else if (dest < src && dest + n > src) {
+		/* Copy from start to end. memcpy() must not be used here,
+		 * it may store a word before loading the source behind it */
 		cdest = dest;
 		csrc = src;
-		for (i = 0; i < n; i++) {
+		if (n >= 16 && (((unsigned long)cdest ^ (unsigned long)csrc) & 7) == 0) {
+			while ((unsigned long)cdest & 7) {
+				*cdest++ = *csrc++;
+				n--;
+			}
+			ldest = (uint64_t *)cdest;
+			lsrc = (const uint64_t *)csrc;
+			while (n >= 8) {
+				*ldest++ = *lsrc++;
+				n -= 8;
+			}
+			cdest = (char *)ldest;
+			csrc = (const char *)lsrc;
+		}
+		while (n-- > 0) {
 			*cdest++ = *csrc++;
 		}
 	}
+	else {
+		/* No overlap */
+		memcpy(dest, src, n);
+	}
 
 	return dest;
 }
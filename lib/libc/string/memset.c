@@ -10,12 +10,65 @@
  *     IBM Corporation - initial implementation
  *****************************************************************************/
 
+#include "stdint.h"
 #include "string.h"
 
+#ifdef __powerpc64__
+/* All processors supported by SLOF (970, POWER7 and later) use 128 byte
+ * cache lines */
+#define CACHE_LINE_SIZE	128
+#endif
+
 void *
 memset(void *dest, int c, size_t size)
 {
 	unsigned char *d = (unsigned char *)dest;
+	uint64_t *ld;
+	uint64_t pattern;
+
+	if (size >= 16) {
+		while ((unsigned long)d & 7) {
+			*d++ = (unsigned char)c;
+			size--;
+		}
+
+		pattern = (unsigned char)c;
+		pattern |= pattern << 8;
+		pattern |= pattern << 16;
+		pattern |= pattern << 32;
+
+		ld = (uint64_t *)d;
+
+#ifdef CACHE_LINE_SIZE
+		/* Clear whole cache lines without reading them first */
+		if (!pattern && size >= 2 * CACHE_LINE_SIZE) {
+			while ((unsigned long)ld & (CACHE_LINE_SIZE - 1)) {
+				*ld++ = 0;
+				size -= 8;
+			}
+			while (size >= CACHE_LINE_SIZE) {
+				asm volatile ("dcbz 0,%0" : : "r"(ld) : "memory");
+				ld += CACHE_LINE_SIZE / 8;
+				size -= CACHE_LINE_SIZE;
+			}
+		}
+#endif
+
+		while (size >= 32) {
+			ld[0] = pattern;
+			ld[1] = pattern;
+			ld[2] = pattern;
+			ld[3] = pattern;
+			ld += 4;
+			size -= 32;
+		}
+		while (size >= 8) {
+			*ld++ = pattern;
+			size -= 8;
+		}
+
+		d = (unsigned char *)ld;
+	}
 
 	while (size-- > 0) {
 		*d++ = (unsigned char)c;
@@ -0,0 +1,255 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*
+ * Host test for the memcpy, memmove, memset and memcmp functions of the
+ * SLOF libc.  The functions are built with a "slof_" prefix (see the
+ * Makefile) and compared against plain bytewise reference versions for
+ * random lengths, alignments and overlaps.  Afterwards the speed of both
+ * versions is printed for some typical sizes.
+ *
+ * Usage: memtest [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* size_t of the SLOF libc is an unsigned int */
+void *slof_memcpy(void *dest, const void *src, unsigned int n);
+void *slof_memmove(void *dest, const void *src, unsigned int n);
+void *slof_memset(void *s, int c, unsigned int n);
+int slof_memcmp(const void *s1, const void *s2, unsigned int n);
+
+#define BUF_SIZE	1024
+#define MAX_LEN		300
+#define MAX_OFFSET	300
+
+static unsigned char src[BUF_SIZE], dst[BUF_SIZE], ref[BUF_SIZE];
+
+/* bytewise reference implementations */
+
+static void * __attribute__((noinline))
+ref_memcpy(void *dest, const void *s, size_t n)
+{
+	unsigned char *d = dest;
+	const unsigned char *cs = s;
+
+	while (n-- > 0)
+		*d++ = *cs++;
+
+	return dest;
+}
+
+static void * __attribute__((noinline))
+ref_memmove(void *dest, const void *s, size_t n)
+{
+	unsigned char *d = dest;
+	const unsigned char *cs = s;
+
+	if (cs < d && cs + n > d) {
+		d += n;
+		cs += n;
+		while (n-- > 0)
+			*--d = *--cs;
+		return dest;
+	}
+
+	return ref_memcpy(dest, s, n);
+}
+
+static void * __attribute__((noinline))
+ref_memset(void *s, int c, size_t n)
+{
+	unsigned char *p = s;
+
+	while (n-- > 0)
+		*p++ = c;
+
+	return s;
+}
+
+static int __attribute__((noinline))
+ref_memcmp(const void *s1, const void *s2, size_t n)
+{
+	const unsigned char *p1 = s1, *p2 = s2;
+
+	for (; n > 0; n--, p1++, p2++) {
+		if (*p1 != *p2)
+			return *p1 - *p2;
+	}
+
+	return 0;
+}
+
+static int
+sign(int val)
+{
+	return (val > 0) - (val < 0);
+}
+
+static void
+fill_random(unsigned char *buf, size_t len)
+{
+	while (len-- > 0)
+		*buf++ = rand();
+}
+
+static int
+check(const char *name, size_t len, size_t soff, size_t doff)
+{
+	if (memcmp(dst, ref, BUF_SIZE) == 0)
+		return 0;
+
+	printf("%s failed: len=%zu src+%zu dst+%zu\n", name, len, soff, doff);
+	return 1;
+}
+
+static int
+fuzz(long iterations)
+{
+	size_t len, soff, doff;
+	long i;
+	int c, ret;
+
+	for (i = 0; i < iterations; i++) {
+		fill_random(src, BUF_SIZE);
+		fill_random(dst, BUF_SIZE);
+		memcpy(ref, dst, BUF_SIZE);
+		len = rand() % MAX_LEN;
+		soff = rand() % MAX_OFFSET;
+		doff = rand() % MAX_OFFSET;
+
+		switch (i % 4) {
+		case 0:
+			ref_memcpy(ref + doff, src + soff, len);
+			if (slof_memcpy(dst + doff, src + soff, len) != dst + doff
+			    || check("memcpy", len, soff, doff))
+				return 1;
+			break;
+		case 1:
+			/* source and destination in the same buffer */
+			ref_memmove(ref + doff, ref + soff, len);
+			if (slof_memmove(dst + doff, dst + soff, len) != dst + doff
+			    || check("memmove", len, soff, doff))
+				return 1;
+			break;
+		case 2:
+			c = rand() % 2 ? 0 : rand();
+			ref_memset(ref + doff, c, len);
+			if (slof_memset(dst + doff, c, len) != dst + doff
+			    || check("memset", len, soff, doff))
+				return 1;
+			break;
+		case 3:
+			memcpy(dst + doff, src + soff, len);
+			if (len && rand() % 2)
+				dst[doff + rand() % len] ^= 1 << (rand() % 8);
+			ret = ref_memcmp(src + soff, dst + doff, len);
+			if (sign(slof_memcmp(src + soff, dst + doff, len))
+			    != sign(ret)) {
+				printf("memcmp failed: len=%zu src+%zu dst+%zu\n",
+				       len, soff, doff);
+				return 1;
+			}
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static double
+elapsed(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void
+bench(void)
+{
+	static const size_t sizes[] = { 16, 256, 4096, 65536, 1 << 20 };
+	unsigned char *a, *b;
+	volatile long sink;
+	unsigned long i, rounds;
+	clock_t start;
+	double t_ref, t_slof;
+	unsigned int k;
+
+	a = malloc((1 << 20) + 8);
+	b = malloc((1 << 20) + 8);
+	if (!a || !b) {
+		printf("bench: out of memory\n");
+		free(a);
+		free(b);
+		return;
+	}
+	memset(a, 0x5a, (1 << 20) + 8);
+	memset(b, 0x5a, (1 << 20) + 8);
+
+	printf("%-8s %8s %12s %12s\n", "", "size", "bytewise", "slof");
+	for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+		rounds = (64UL << 20) / sizes[k];
+
+#define BENCH(name, ref_call, slof_call)				\
+		start = clock();					\
+		for (i = 0; i < rounds; i++) {				\
+			sink = (long)ref_call;				\
+			__asm__ __volatile__("" : : "r"(a), "r"(b) : "memory"); \
+		}							\
+		t_ref = elapsed(start);					\
+		start = clock();					\
+		for (i = 0; i < rounds; i++) {				\
+			sink = (long)slof_call;				\
+			__asm__ __volatile__("" : : "r"(a), "r"(b) : "memory"); \
+		}							\
+		t_slof = elapsed(start);				\
+		printf("%-8s %8zu %9.0f MB/s %9.0f MB/s\n", name,	\
+		       sizes[k], 64 / t_ref, 64 / t_slof);
+
+		/* misaligned source: the shifting path of memcpy */
+		BENCH("memcpy", ref_memcpy(b, a + 3, sizes[k]),
+		      slof_memcpy(b, a + 3, sizes[k]));
+		BENCH("memmove", ref_memmove(b + 8, b, sizes[k]),
+		      slof_memmove(b + 8, b, sizes[k]));
+		BENCH("memset", ref_memset(b, 0, sizes[k]),
+		      slof_memset(b, 0, sizes[k]));
+		/* equal buffers, so the whole length is compared */
+		memcpy(b, a, sizes[k]);
+		BENCH("memcmp", ref_memcmp(a, b, sizes[k]),
+		      slof_memcmp(a, b, sizes[k]));
+#undef BENCH
+	}
+
+	(void)sink;
+	free(a);
+	free(b);
+}
+
+int
+main(int argc, char *argv[])
+{
+	long iterations = 1000000;
+
+	if (argc > 1)
+		iterations = atol(argv[1]);
+
+	srand(1);
+	if (fuzz(iterations))
+		return 1;
+	printf("memtest: %ld random checks passed\n", iterations);
+
+	bench();
+
+	return 0;
+}
@@ -63,6 +63,25 @@ typedef struct {
 	uint16_t m_spe_u16;
 }	__attribute__ ((packed)) e1k_tx_desc_st;
 
+/*
+ * transmit context descriptor (checksum offsets for the following
+ * extended data descriptors), shares the ring with e1k_tx_desc_st
+ */
+typedef struct {
+	uint8_t m_ipcss_u08;
+	uint8_t m_ipcso_u08;
+	uint16_t m_ipcse_u16;
+	uint8_t m_tucss_u08;
+	uint8_t m_tucso_u08;
+	uint16_t m_tucse_u16;
+	uint16_t m_paylen_u16;
+	uint8_t m_dtyp_u08;
+	uint8_t m_tucmd_u08;
+	uint8_t m_sta_u08;
+	uint8_t m_hdrlen_u08;
+	uint16_t m_mss_u16;
+}	__attribute__ ((packed)) e1k_tx_ctx_st;
+
 
 /*
  * receive buffer descriptor
@@ -172,6 +191,8 @@ static const e1k_dev_t e1k_dev[] = {
  */
 static e1k_st	m_e1k __attribute__ ((aligned(16)));
 static long dma_offset;
+static int tx_csum;	// client wants UDP checksums offloaded
+static uint8_t tx_ctx_css;	// TUCSS of the loaded context, 0 - none
 
 /*
  * global functions
@@ -638,6 +659,8 @@ e1k_xmit(char *f_buffer_pc, int f_len_i)
 	uint32_t	l_pre_u32 = (l_tdh_u32 + (E1K_NUM_TX_DESC - 1)) &
 				    (E1K_NUM_TX_DESC - 1);
 	e1k_tx_desc_st	*tx;
+	e1k_tx_ctx_st	*ctx;
+	uint8_t		l_css_u08 = 0;
 	#if defined(E1K_DEBUG) && defined(E1K_SHOW_XMIT_DATA)
 	int		i;
 	#endif
@@ -650,14 +673,48 @@ e1k_xmit(char *f_buffer_pc, int f_len_i)
 	}
 
 	/*
-	 * get a pointer to the next tx descriptor for ease of use
+	 * let the NIC complete the UDP checksum of unfragmented IPv4
+	 * packets; the client has put the pseudo header sum into the field
+	 */
+	if (tx_csum && f_len_i >= 14 + 20 + 8 &&
+	    f_buffer_pc[12] == 0x08 && f_buffer_pc[13] == 0x00 &&
+	    f_buffer_pc[14 + 9] == 17 &&
+	    !(f_buffer_pc[14 + 6] & 0x3f) && !f_buffer_pc[14 + 7]) {
+		l_css_u08 = 14 + (f_buffer_pc[14] & 0x0f) * 4;
+	}
+
+	/*
+	 * the checksum offsets are taken from a context descriptor, which
+	 * the NIC keeps until the next one; it needs a ring slot of its own
+	 */
+	if (l_css_u08 && l_css_u08 != tx_ctx_css) {
+		if (((l_tdt_u32 + 1) & (E1K_NUM_TX_DESC - 1)) == l_pre_u32) {
+			return 0;
+		}
+
+		ctx = (e1k_tx_ctx_st *) &m_e1k.m_tx_ring_pst[l_tdt_u32];
+		memset((uint8_t *) ctx, 0, sizeof(e1k_tx_ctx_st));
+		ctx->m_tucss_u08 = l_css_u08;
+		ctx->m_tucso_u08 = l_css_u08 + 6;
+		ctx->m_tucmd_u08 = (BIT08(5) |	// DEXT
+				    BIT08(1));	// IP (IPv4), UDP
+		tx_ctx_css = l_css_u08;
+
+		l_tdt_u32 = (l_tdt_u32 + 1) & (E1K_NUM_TX_DESC - 1);
+	}
+
+	/*
+	 * get a pointer to the next tx descriptor for ease of use; a context
+	 * descriptor may have overwritten the buffer pointer of this slot
 	 */
 	tx = &m_e1k.m_tx_ring_pst[l_tdt_u32];
+	tx->m_buffer_u64 =
+		bswap_64(virt2dma(&m_e1k.m_tx_buffer_pu08[l_tdt_u32][0]));
 
 	/*
 	 * copy the data
 	 */
-	memcpy(dma2virt(bswap_64(tx->m_buffer_u64)), (uint8_t *) f_buffer_pc,
+	memcpy(&m_e1k.m_tx_buffer_pu08[l_tdt_u32][0], (uint8_t *) f_buffer_pc,
 		(size_t) f_len_i);
 
 	/*
@@ -667,6 +724,19 @@ e1k_xmit(char *f_buffer_pc, int f_len_i)
 	tx->m_cmd_u08 = (BIT08(0) |		// EOP
 			  BIT08(1));		// IFCS
 	tx->m_sta_u08 = 0;
+	tx->m_css_u08 = 0;
+	tx->m_cso_u08 = 0;
+	tx->m_spe_u16 = 0;
+
+	/*
+	 * an extended data descriptor (DTYP 1) with POPTS.TXSM uses the
+	 * offsets of the context; CSO and CSS turn into DTYP and POPTS
+	 */
+	if (l_css_u08) {
+		tx->m_cso_u08 = 0x10;		// DTYP data
+		tx->m_cmd_u08 |= BIT08(5);	// DEXT
+		tx->m_css_u08 = BIT08(1);	// POPTS.TXSM
+	}
 	mb();
 
 	/*
@@ -757,6 +827,9 @@ e1k_init(net_driver_t *driver)
 	printf("\ne1k: initializing\n");
 	#endif
 
+	tx_csum = 0;
+	tx_ctx_css = 0;
+
 	dma_offset = SLOF_dma_map_in(&m_e1k, sizeof(m_e1k), 0);
 	#ifdef E1K_DEBUG
 	printf("e1k: dma offset: %lx - %lx = %lx\n", dma_offset, (long)&m_e1k,
@@ -986,6 +1059,15 @@ int e1k_write(char *buf, int len)
 	return -1;
 }
 
+/*
+ * enable or disable UDP checksum offload (context descriptor and TXSM)
+ */
+int e1k_set_tx_csum(int enable)
+{
+	tx_csum = enable;
+	return 1;
+}
+
 int e1k_mac_setup(uint16_t vendor_id, uint16_t device_id,
 			uint64_t baseaddr, char *mac_addr)
 {
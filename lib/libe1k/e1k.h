@@ -104,5 +104,6 @@ extern net_driver_t *e1k_open(void);
 extern void e1k_close(net_driver_t *driver);
 extern int e1k_read(char *buf, int len);
 extern int e1k_write(char *buf, int len);
+extern int e1k_set_tx_csum(int enable);
 extern int e1k_mac_setup(uint16_t vendor_id, uint16_t device_id,
 			uint64_t baseaddr, char *mac_addr);
@@ -94,6 +94,82 @@ elf_load_file(void *file_addr, unsigned long *entry,
 }
 
 
+/**
+ * Read len bytes at offset of the file to dest, the read handler may
+ * return less than requested.
+ * @return  0 on success, -1 if the file could not be read
+ */
+int
+elf_read_all(long (*read)(void*, unsigned long, long), void *dest,
+             unsigned long offset, long len)
+{
+	long actual;
+
+	while (len > 0) {
+		actual = read(dest, offset, len);
+		if (actual <= 0)
+			return -1;
+		dest = (char *)dest + actual;
+		offset += actual;
+		len -= actual;
+	}
+
+	return 0;
+}
+
+/**
+ * elf_load_stream loads an ELF file without having the whole file in
+ * memory: the segments are read directly to their load addresses.
+ *
+ * @param hdr        pointer to the first hdr_len bytes of the file
+ * @param hdr_len    must cover the ELF and all program headers
+ * @param entry      pointer where the ELF loader will store
+ *                   the entry point
+ * @param read       handler that reads (dest, file offset, len) and
+ *                   returns the number of bytes read
+ * @param pre_load   handler that is called before reading a segment
+ * @param post_load  handler that is called after reading a segment
+ * @return           1 for a 32 bit file
+ *                   2 for a 64 bit file
+ *                   -1 to -4 like elf_check_file, nothing is loaded
+ *                   -5 if hdr does not hold all headers, nothing is loaded
+ *                   -6 if a segment could not be read
+ */
+int
+elf_load_stream(void *hdr, long hdr_len, unsigned long *entry,
+                long (*read)(void*, unsigned long, long),
+                int (*pre_load)(void*, long),
+                void (*post_load)(void*, long))
+{
+	/* The segments might overwrite the headers while loading */
+	static uint8_t hdr_copy[ELF_STREAM_HDR_SIZE] __attribute__((aligned(8)));
+	int type, ret = -5;
+
+	if (hdr_len > ELF_STREAM_HDR_SIZE)
+		hdr_len = ELF_STREAM_HDR_SIZE;
+	if (hdr_len < (long)sizeof(struct ehdr))
+		return -1;
+	memcpy(hdr_copy, hdr, hdr_len);
+
+	type = elf_check_file((unsigned long *)hdr_copy);
+
+	switch (type) {
+	case 1:
+		ret = elf_stream_segments32(hdr_copy, hdr_len, entry, read,
+		                            pre_load, post_load);
+		break;
+	case 2:
+		ret = elf_stream_segments64(hdr_copy, hdr_len, entry, read,
+		                            pre_load, post_load);
+		break;
+	default:
+		return type;
+	}
+
+	return ret ? ret : type;
+}
+
+
 /**
  * load_elf_file_to_addr loads an ELF file to given address.
  * This is useful for 64-bit vmlinux images that use the virtual entry
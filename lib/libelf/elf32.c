@@ -117,6 +117,50 @@ elf_load_segments32(void *file_addr, signed long offset,
 	return ehdr->e_entry + virt2phys;
 }
 
+/**
+ * 32-bit version of elf_stream_segments64()
+ */
+int
+elf_stream_segments32(void *hdr, long hdr_len, unsigned long *entry,
+                      long (*read)(void*, unsigned long, long),
+                      int (*pre_load)(void*, long),
+                      void (*post_load)(void*, long))
+{
+	struct ehdr32 *ehdr = (struct ehdr32 *) hdr;
+	struct phdr32 *phdr = get_phdr32(hdr);
+	unsigned long destaddr;
+	signed int virt2phys = 0;
+	int i;
+
+	if (ehdr->e_phoff + ehdr->e_phnum * ehdr->e_phentsize
+	    > (unsigned long) hdr_len)
+		return -5;
+
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if (phdr->p_type == 1) {
+			if (!virt2phys)
+				virt2phys = phdr->p_paddr - phdr->p_vaddr;
+
+			destaddr = (unsigned long)phdr->p_paddr;
+			if (pre_load == NULL
+			    || pre_load((void*)destaddr, phdr->p_memsz) == 0) {
+				if (elf_read_all(read, (void*)destaddr,
+				                 phdr->p_offset, phdr->p_filesz))
+					return -6;
+				memset((void *)(destaddr + phdr->p_filesz), 0,
+				       phdr->p_memsz - phdr->p_filesz);
+				if (phdr->p_memsz && post_load)
+					post_load((void*)destaddr, phdr->p_memsz);
+			}
+		}
+		phdr = (struct phdr32 *)(((uint8_t *)phdr) + ehdr->e_phentsize);
+	}
+
+	*entry = ehdr->e_entry + virt2phys;
+
+	return 0;
+}
+
 /**
  * Return the base address for loading (i.e. the address of the first PT_LOAD
  * segment)
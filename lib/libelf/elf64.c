@@ -265,6 +265,58 @@ elf_load_segments64(void *file_addr, signed long offset,
 	return ehdr->e_entry + virt2phys;
 }
 
+/**
+ * Load the segments straight from the device to their destination.
+ * Only the ELF and program headers have to be in memory, the contents
+ * of the segments are fetched with the read handler.
+ * @param  hdr		pointer to the start of the file (the headers)
+ * @param  hdr_len	number of valid bytes at hdr
+ * @param  entry	pointer where the entry point is stored
+ * @return		0 on success
+ *			-5 if the program headers are not within hdr_len
+ *			-6 if a segment could not be read
+ */
+int
+elf_stream_segments64(void *hdr, long hdr_len, unsigned long *entry,
+                      long (*read)(void*, unsigned long, long),
+                      int (*pre_load)(void*, long),
+                      void (*post_load)(void*, long))
+{
+	struct ehdr64 *ehdr = (struct ehdr64 *) hdr;
+	struct phdr64 *phdr = get_phdr64(hdr);
+	unsigned long destaddr;
+	signed long virt2phys = 0;
+	int i;
+
+	if (ehdr->e_phoff + ehdr->e_phnum * ehdr->e_phentsize
+	    > (unsigned long) hdr_len)
+		return -5;
+
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if (phdr->p_type == PT_LOAD) {
+			if (!virt2phys)
+				virt2phys = phdr->p_paddr - phdr->p_vaddr;
+
+			destaddr = phdr->p_paddr;
+			if (pre_load == NULL
+			    || pre_load((void*)destaddr, phdr->p_memsz) == 0) {
+				if (elf_read_all(read, (void*)destaddr,
+				                 phdr->p_offset, phdr->p_filesz))
+					return -6;
+				memset((void*)(destaddr + phdr->p_filesz), 0,
+				       phdr->p_memsz - phdr->p_filesz);
+				if (phdr->p_memsz && post_load != NULL)
+					post_load((void*)destaddr, phdr->p_memsz);
+			}
+		}
+		phdr = (struct phdr64 *)(((uint8_t *)phdr) + ehdr->e_phentsize);
+	}
+
+	*entry = ehdr->e_entry + virt2phys;
+
+	return 0;
+}
+
 /**
  * Return the base address for loading (i.e. the address of the first PT_LOAD
  * segment)
@@ -26,3 +26,16 @@ elf_forth_claim(void *addr, long size)
 	forth_eval("elf-claim-segment");
 	return forth_pop();
 }
+
+/**
+ * Call Forth code to read part of the file that is being streamed
+ */
+long
+elf_forth_read(void *dest, unsigned long offset, long len)
+{
+	forth_push((long)dest);
+	forth_push(offset);
+	forth_push(len);
+	forth_eval("elf-read-segment");
+	return forth_pop();
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*
+ * Buffered hvterm output: H_PUT_TERM_CHAR takes up to 16 bytes in two
+ * registers, so characters are collected here and sent with one hypercall
+ * per 16 bytes instead of one per character.
+ */
+
+#include <stdint.h>
+#include "libhvcall.h"
+
+#define HV_TERM_BUF_SIZE	16
+
+static union {
+	char c[HV_TERM_BUF_SIZE];
+	unsigned long l[2];
+} outbuf;
+static int outlen;
+static int outno;
+
+/* Send the pending output to the terminal it was written to */
+void hv_flushterm(void)
+{
+	if (!outlen)
+		return;
+	hv_generic(H_PUT_TERM_CHAR, outno, outlen, outbuf.l[0], outbuf.l[1]);
+	outlen = 0;
+}
+
+/* Queue a character, flush on newline or when the buffer is full */
+void hv_putchar_buffered(char c, int hvtermno)
+{
+	if (outlen && hvtermno != outno)
+		hv_flushterm();
+	outno = hvtermno;
+	outbuf.c[outlen++] = c;
+	if (c == '\n' || outlen == HV_TERM_BUF_SIZE)
+		hv_flushterm();
+}
+
+/* Write a string, using as few hypercalls as possible */
+void hv_putbuf(const char *buf, int len, int hvtermno)
+{
+	while (len-- > 0)
+		hv_putchar_buffered(*buf++, hvtermno);
+	hv_flushterm();
+}
@@ -30,6 +30,9 @@
 extern long hv_generic(unsigned long opcode, ...);
 
 extern void hv_putchar(char c, int hvtermno);
+extern void hv_putchar_buffered(char c, int hvtermno);
+extern void hv_putbuf(const char *buf, int len, int hvtermno);
+extern void hv_flushterm(void);
 extern char hv_getchar(int hvtermno);
 extern char hv_haschar(int hvtermno);
 
@@ -16,26 +16,160 @@
 #include "../libc/include/stdlib.h"
 #include "nvram.h"
 
-/* returns the offset of the first byte after the searched envvar */
-static int get_past_env_pos(partition_t part, char *envvar)
+/*
+ * The partition holds a list of "name=value" strings, terminated by an
+ * empty string.  To avoid rescanning it on every lookup, the offsets of
+ * the entries are kept in a hash table keyed by name.  After our own
+ * rewrites the table is rebuilt from the new partition image in RAM;
+ * it is rebuilt from NVRAM whenever the partition changes or NVRAM has
+ * been written by someone else (see nvram_get_generation()).  Names of
+ * ENV_NAME_MAX bytes or more are not hashed, they are looked up with a
+ * linear scan.
+ */
+
+#define ENV_HASH_SIZE	1024	/* must be a power of 2 */
+#define ENV_HASH_MAX	(ENV_HASH_SIZE / 4 * 3)
+#define ENV_NAME_MAX	255
+
+static struct {
+	unsigned long addr;
+	long len;
+	unsigned long generation;
+	int valid;
+	int indexed;	/* 0 if there were too many entries to hash */
+	uint32_t slot[ENV_HASH_SIZE];	/* entry offset, 0 = empty */
+} env_index;
+
+static uint32_t env_hash(const char *name, int len)
+{
+	uint32_t hash = 2166136261u;	/* FNV-1a */
+	int i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+
+	return hash;
+}
+
+/*
+ * Read a byte of the partition, either from NVRAM or (if image is not
+ * NULL) from a RAM copy of the partition contents
+ */
+static inline uint8_t env_read(partition_t part, const char *image, int offset)
+{
+	if (image)
+		return image[offset - part.addr];
+	return nvram_read_byte(offset);
+}
+
+/* does the entry at offset carry the given name? */
+static int env_match_image(partition_t part, const char *image, int offset,
+			   const char *name, int len)
+{
+	int i;
+	uint8_t data;
+
+	for (i = 0; i < len; i++) {
+		if (env_read(part, image, offset + i) != (uint8_t)name[i])
+			return 0;
+	}
+	data = env_read(part, image, offset + len);
+
+	return data == '=' || data == 0;
+}
+
+static int env_match(int offset, const char *name, int len)
+{
+	return env_match_image((partition_t) {0}, NULL, offset, name, len);
+}
+
+/* returns the offset of the first byte after the entry at offset */
+static int env_next_image(partition_t part, const char *image, int offset)
+{
+	int end = part.addr + part.len;
+
+	while (offset < end && env_read(part, image, offset))
+		offset++;
+
+	return offset + 1;
+}
+
+static int env_next(partition_t part, int offset)
 {
-	int offset, len;
-	static char temp[256];
+	return env_next_image(part, NULL, offset);
+}
+
+static void env_index_build(partition_t part, const char *image)
+{
+	char name[ENV_NAME_MAX];
+	int offset, end, len, count = 0;
+	uint32_t i;
 	uint8_t data;
 
-	offset=part.addr;
+	memset(env_index.slot, 0, sizeof(env_index.slot));
+	env_index.addr = part.addr;
+	env_index.len = part.len;
+	env_index.indexed = 1;
+
+	end = part.addr + part.len;
+	for (offset = part.addr; offset < end && env_read(part, image, offset);
+	     offset = env_next_image(part, image, offset)) {
+		if (++count > ENV_HASH_MAX) {
+			env_index.indexed = 0;
+			break;
+		}
+		for (len = 0; len < ENV_NAME_MAX && offset + len < end; len++) {
+			data = env_read(part, image, offset + len);
+			if (data == '=' || data == 0)
+				break;
+			name[len] = data;
+		}
+		if (len == ENV_NAME_MAX)
+			continue;	/* found with a linear scan */
+		i = env_hash(name, len) & (ENV_HASH_SIZE - 1);
+		while (env_index.slot[i]) {
+			/* Only the first of duplicate entries is visible */
+			if (env_match_image(part, image, env_index.slot[i],
+					    name, len))
+				break;
+			i = (i + 1) & (ENV_HASH_SIZE - 1);
+		}
+		if (!env_index.slot[i])
+			env_index.slot[i] = offset;
+	}
 
-	memset(temp, 0, 256);
+	env_index.generation = nvram_get_generation();
+	env_index.valid = 1;
+}
 
-	do {
-		len=0;
-		while((data=nvram_read_byte(offset++)) && len < 256) {
-			temp[len++]=data;
+/* returns the offset of the entry for envvar or -1 */
+static int env_find(partition_t part, const char *envvar)
+{
+	int len = strlen(envvar);
+	int offset, end;
+	uint32_t i;
+
+	if (!env_index.valid || env_index.addr != part.addr
+	    || env_index.len != part.len
+	    || env_index.generation != nvram_get_generation())
+		env_index_build(part, NULL);
+
+	if (env_index.indexed && len < ENV_NAME_MAX) {
+		i = env_hash(envvar, len) & (ENV_HASH_SIZE - 1);
+		while (env_index.slot[i]) {
+			if (env_match(env_index.slot[i], envvar, len))
+				return env_index.slot[i];
+			i = (i + 1) & (ENV_HASH_SIZE - 1);
 		}
-		if (!strncmp(envvar, temp, strlen(envvar))) {
+		return -1;
+	}
+
+	end = part.addr + part.len;
+	for (offset = part.addr; offset < end && nvram_read_byte(offset);
+	     offset = env_next(part, offset)) {
+		if (env_match(offset, envvar, len))
 			return offset;
-		}
-	} while (len);
+	}
 
 	return -1;
 }
@@ -59,185 +193,138 @@ char *get_env(partition_t part, char *envvar)
 		return NULL;
 	}
 
-	offset=part.addr;
+	offset = env_find(part, envvar);
+	if (offset < 0) {
+		DEBUG("not found\n");
+		return NULL;
+	}
 
-	do {
-		len=0;
-		while((data=nvram_read_byte(offset++)) && len < 256) {
-			temp[len++]=data;
-		}
-		temp[len]=0;
+	/* skip the name and the '=' */
+	offset += strlen(envvar);
+	if (nvram_read_byte(offset) == '=')
+		offset++;
 
-		if (!strncmp(envvar, temp, strlen(envvar))) {
-			int pos=0;
-			while (temp[pos]!='=' && pos < len) pos++;
-			// DEBUG("value='%s'\n", temp+pos+1); 
-			return temp+pos+1;
-		}
-	} while (len);
+	len = 0;
+	while ((data = nvram_read_byte(offset++)) && len < 256)
+		temp[len++] = data;
+	temp[len] = 0;
 
-	DEBUG("not found\n");
-	return NULL;
+	return temp;
 }
 
-static int find_last_envvar(partition_t part)
+static int env_put(char *buffer, int pos, int size, const char *envvar,
+		   const char *value)
 {
-	uint8_t last, current;
-	int offset;
-
-	offset=part.addr;
+	int nlen = strlen(envvar), vlen = strlen(value);
 
-	last=nvram_read_byte(part.addr);
-
-	for (offset=part.addr; offset<(int)(part.addr+part.len); offset++) {
-		current=nvram_read_byte(offset);
-		if(!last && !current)
-			return offset;
+	if (pos + nlen + vlen + 2 > size)
+		return -1;
 
-		last=current;
-	}
+	memcpy(buffer + pos, envvar, nlen);
+	buffer[pos + nlen] = '=';
+	memcpy(buffer + pos + nlen + 1, value, vlen);
+	buffer[pos + nlen + vlen + 1] = 0;
 
-	return -1;
+	return pos + nlen + vlen + 2;
 }
 
-int add_env(partition_t part, char *envvar, char *value)
+/*
+ * Build the new partition contents with envvar set to value (or removed
+ * if value is NULL) and write it back in one pass.  Entries keep their
+ * order and the holes left by removed or shrunk entries are squeezed
+ * out.  Only bytes that differ are written.
+ */
+static int env_rewrite(partition_t part, const char *envvar, const char *value)
 {
-	int freespace, last, len, offset;
-	unsigned int i;
+	int offset, next, end, pos = 0, done = 0, len = strlen(envvar);
+	char *buffer;
 
-	/* Find offset where we can write */
-	last = find_last_envvar(part);
+	if (!part.addr)
+		return -1;
 
-	/* How much space do we have left? */
-	freespace = part.addr+part.len-last;
+	buffer = get_nvram_buffer(part.len);
+	if (!buffer)
+		return -1;
 
-	/* how long is the entry we want to write? */
-	len = strlen(envvar) + strlen(value) + 2;
+	/* part.len - 1: keep room for the terminating empty string */
+	end = part.addr + part.len;
+	for (offset = part.addr; offset < end && nvram_read_byte(offset);
+	     offset = next) {
+		next = env_next(part, offset);
+		if (env_match(offset, envvar, len)) {
+			if (!value || done)
+				continue;
+			pos = env_put(buffer, pos, part.len - 1, envvar, value);
+			done = 1;
+		} else if (pos + next - offset <= part.len - 1) {
+			for (; offset < next; offset++)
+				buffer[pos++] = nvram_read_byte(offset);
+		} else {
+			pos = -1;
+		}
+		if (pos < 0)
+			break;
+	}
+
+	if (value && !done && pos >= 0)
+		pos = env_put(buffer, pos, part.len - 1, envvar, value);
 
-	if(freespace<len) {
-		// TODO try to increase partition size
+	if (pos < 0) {
+		/* does not fit, leave the partition untouched */
+		free_nvram_buffer(buffer);
 		return -1;
 	}
 
-	offset=last;
+	memset(buffer + pos, 0, part.len - pos);
 
-	for(i=0; i<strlen(envvar); i++)
-		nvram_write_byte(offset++, envvar[i]);
+	for (offset = 0; offset < part.len; offset++) {
+		if (nvram_read_byte(part.addr + offset) != (uint8_t)buffer[offset])
+			nvram_write_byte(part.addr + offset, buffer[offset]);
+	}
 
-	nvram_write_byte(offset++, '=');
+	/* the new contents are at hand, no need to read them back */
+	env_index_build(part, buffer);
 
-	for(i=0; i<strlen(value); i++)
-		nvram_write_byte(offset++, value[i]);
+	free_nvram_buffer(buffer);
 
 	return 0;
 }
 
+int add_env(partition_t part, char *envvar, char *value)
+{
+	return env_rewrite(part, envvar, value);
+}
+
 int del_env(partition_t part, char *envvar)
 {
-	int last, current, pos, i;
-	char *buffer;
+	int ret;
 
 	if(!part.addr)
 		return -1;
 
-	last=find_last_envvar(part);
-	current = pos = get_past_env_pos(part, envvar);
-	
-	// TODO is this really required?
-	/* go back to non-0 value */
-	current--;
-
-	while (nvram_read_byte(current))
-		current--;
-
-	// TODO is this required?
-	current++;
-
-	buffer=get_nvram_buffer(last-pos);
-
-	for (i=0; i<last-pos; i++)
-		buffer[i]=nvram_read_byte(i+pos);
-
-	for (i=0; i<last-pos; i++)
-		nvram_write_byte(i+current, buffer[i]);
-
-	free_nvram_buffer(buffer);
-
-	erase_nvram(last, current+last-pos);
+	ret = env_rewrite(part, envvar, NULL);
+	nvram_sync();
 
-	return 0;
+	return ret;
 }
 
 int set_env(partition_t part, char *envvar, char *value)
 {
-	char *oldvalue, *buffer;
-	int last, current, buffersize, i;
+	char *oldvalue;
+	int ret;
 
 	DEBUG("set_env %lx[%lx]: %s=%s\n", part.addr, part.len, envvar, value);
 
 	if(!part.addr)
 		return -1;
 
-	/* Check whether the environment variable exists already */
-	oldvalue = get_env(part, envvar);
-
-	if(oldvalue==NULL)
-		return add_env(part, envvar, value);
-
-
 	/* The value did not change. So we succeeded! */
-	if(!strncmp(oldvalue, value, strlen(value)+1))
+	oldvalue = get_env(part, envvar);
+	if (oldvalue && !strncmp(oldvalue, value, strlen(value)+1))
 		return 0;
 
-	/* we need to overwrite environment variables, back them up first */
-
-	// DEBUG("overwriting existing environment variable\n");
-
-	/* allocate a buffer */
-	last=find_last_envvar(part);
-	current=get_past_env_pos(part, envvar);
-	buffersize = last - current;
-	buffer=get_nvram_buffer(buffersize);
-	if(!buffer)
-		return -1;
-
-	for (i=0; i<buffersize; i++) {
-		buffer[i] = nvram_read_byte(current+i);
-	}
-
-	/* walk back until the = */
-	while (nvram_read_byte(current)!='=') {
-		current--;
-	}
+	ret = env_rewrite(part, envvar, value);
+	nvram_sync();
 
-	/* Start at envvar= */
-	current++;
-
-	/* Write the new value */
-	for(i=0; i<(int)strlen(value); i++) {
-		nvram_write_byte(current++, value[i]);
-	}
-	
-	/* Write end of string marker */
-	nvram_write_byte(current++, 0);
-
-	/* Copy back the buffer */
-	for (i=0; i<buffersize; i++) {
-		nvram_write_byte(current++, buffer[i]);
-	}
-
-	free_nvram_buffer(buffer);
-
-	/* If the new environment variable content is shorter than the old one,
-	 * we need to erase the rest of the bytes 
-	 */
-
-	if (current<last) {
-		for(i=current; i<last; i++) {
-			nvram_write_byte(i, 0);
-		}
-	}
-
-	return 0; /* success */
+	return ret;
 }
-
@@ -26,6 +26,7 @@ static uint32_t fetch_token;
 static uint32_t store_token;
 static uint32_t NVRAM_LENGTH;
 static char *nvram_buffer; /* use buffer allocated by SLOF code */
+static char *nvram_shadow; /* RAM copy of the whole NVRAM image */
 #else
 #ifndef NVRAM_LENGTH
 #define NVRAM_LENGTH	0x10000
@@ -39,20 +40,8 @@ static char nvram_buffer[NVRAM_LENGTH];
 
 static uint8_t nvram_buffer_locked=0x00;
 
-void nvram_init(uint32_t _fetch_token, uint32_t _store_token, 
-		long _nvram_length, void* nvram_addr)
-{
-#ifdef RTAS_NVRAM
-	fetch_token = _fetch_token;
-	store_token = _store_token;
-	NVRAM_LENGTH = _nvram_length;
-	nvram_buffer = nvram_addr;
-
-	DEBUG("\nNVRAM: size=%d, fetch=%x, store=%x\n",
-		NVRAM_LENGTH, fetch_token, store_token);
-#endif
-}
-
+/* Bumped on every write, lets users of the contents notice changes */
+static unsigned long nvram_generation;
 
 void asm_cout(long Character,long UART,long NVRAM);
 
@@ -76,6 +65,7 @@ static volatile uint8_t nvram[NVRAM_LENGTH]; /* FAKE */
 			return;					\
 		pos = (type *)(nvram+offset);			\
 		*pos = data;					\
+		nvram_generation++;				\
 	}
 
 #elif defined(RTAS_NVRAM)
@@ -102,20 +92,86 @@ static inline void nvram_store(unsigned int offset, void *buf, unsigned int len)
 	h_rtas(&rtas);
 }
 
+/*
+ * Writes only go to the RAM shadow and remember the modified byte ranges.
+ * nvram_sync() stores each range back with a single RTAS call.
+ */
+#define NVRAM_DIRTY_RANGES	8
+
+static struct {
+	unsigned int start;
+	unsigned int end;
+} nvram_dirty[NVRAM_DIRTY_RANGES];
+static int nvram_dirty_count;
+
+static void nvram_mark_dirty(unsigned int offset, unsigned int len)
+{
+	unsigned int end = offset + len;
+	unsigned int gap, best_gap = -1;
+	int i, best = 0;
+
+	for (i = 0; i < nvram_dirty_count; i++) {
+		if (offset <= nvram_dirty[i].end && end >= nvram_dirty[i].start)
+			break;
+	}
+
+	if (i == nvram_dirty_count) {
+		if (nvram_dirty_count < NVRAM_DIRTY_RANGES) {
+			nvram_dirty[i].start = offset;
+			nvram_dirty[i].end = end;
+			nvram_dirty_count++;
+			return;
+		}
+		/* Table is full: widen the range closest to the new one */
+		for (i = 0; i < nvram_dirty_count; i++) {
+			if (offset > nvram_dirty[i].end)
+				gap = offset - nvram_dirty[i].end;
+			else
+				gap = nvram_dirty[i].start - end;
+			if (gap < best_gap) {
+				best_gap = gap;
+				best = i;
+			}
+		}
+		i = best;
+	}
+
+	if (offset < nvram_dirty[i].start)
+		nvram_dirty[i].start = offset;
+	if (end > nvram_dirty[i].end)
+		nvram_dirty[i].end = end;
+}
+
+void nvram_sync(void)
+{
+	int i;
+
+	for (i = 0; i < nvram_dirty_count; i++)
+		nvram_store(nvram_dirty[i].start,
+			    nvram_shadow + nvram_dirty[i].start,
+			    nvram_dirty[i].end - nvram_dirty[i].start);
+
+	nvram_dirty_count = 0;
+}
+
 #define nvram_access(type,size,name) 				\
 	type nvram_read_##name(unsigned int offset)		\
 	{							\
 		type val;					\
-		if (offset > (NVRAM_LENGTH - sizeof(type)))	\
+		if (!nvram_shadow ||				\
+		    offset > (NVRAM_LENGTH - sizeof(type)))	\
 			return 0;				\
-		nvram_fetch(offset, &val, size / 8);		\
+		memcpy(&val, nvram_shadow + offset, size / 8);	\
 		return val;					\
 	}							\
 	void nvram_write_##name(unsigned int offset, type data)	\
 	{							\
-		if (offset > (NVRAM_LENGTH - sizeof(type)))	\
+		if (!nvram_shadow ||				\
+		    offset > (NVRAM_LENGTH - sizeof(type)))	\
 			return;					\
-		nvram_store(offset, &data, size / 8);		\
+		memcpy(nvram_shadow + offset, &data, size / 8);	\
+		nvram_mark_dirty(offset, size / 8);		\
+		nvram_generation++;				\
 	}
 
 #else	/* DISABLE_NVRAM */
@@ -138,10 +194,37 @@ static volatile uint8_t *nvram = (volatile uint8_t *)SB_NVRAM_adr;
 			return;					\
 		pos = (type *)(nvram+offset);			\
 		ci_write_##size(pos, data);			\
+		nvram_generation++;				\
 	}
 
 #endif
 
+#ifndef RTAS_NVRAM
+void nvram_sync(void)
+{
+	/* Writes go to the device directly, nothing to do */
+}
+#endif
+
+void nvram_init(uint32_t _fetch_token, uint32_t _store_token, 
+		long _nvram_length, void* nvram_addr, void *shadow_addr)
+{
+#ifdef RTAS_NVRAM
+	fetch_token = _fetch_token;
+	store_token = _store_token;
+	NVRAM_LENGTH = _nvram_length;
+	nvram_buffer = nvram_addr;
+
+	/* Every hypercall is a VM exit, so read the image once and work
+	 * on the copy in RAM from now on */
+	nvram_fetch(0, shadow_addr, NVRAM_LENGTH);
+	nvram_shadow = shadow_addr;
+
+	DEBUG("\nNVRAM: size=%d, fetch=%x, store=%x\n",
+		NVRAM_LENGTH, fetch_token, store_token);
+#endif
+}
+
 /*
  * producer for nvram access functions. Since these functions are
  * basically all the same except for the used data types, produce 
@@ -369,6 +452,7 @@ void erase_nvram(int offset, int len)
 void wipe_nvram(void)
 {
 	erase_nvram(0, NVRAM_LENGTH);
+	nvram_sync();
 }
 
 /**
@@ -462,6 +546,7 @@ partition_t new_nvram_partition(int type, char *name, int len)
 	}
 
 	create_free_partition();
+	nvram_sync();
 
 	return new_part;
 }
@@ -487,6 +572,7 @@ int delete_nvram_partition(partition_t partition)
 	free_part=get_partition(0x7f, NULL);
 	wipe_partition(free_part, 0);
 	create_free_partition();
+	nvram_sync();
 
 	return 1;
 }
@@ -562,6 +648,7 @@ int increase_nvram_partition_size(partition_t partition, int newsize)
 	nvram_write_word(partition.addr - 16 + 2, newsize);
 
 	create_free_partition();
+	nvram_sync();
 
 	return 1;
 }
@@ -607,6 +694,7 @@ void reset_nvram(void)
 	create_nvram_partition(0x70, "common", 0x01000-PARTITION_HEADER_SIZE);
 
 	create_free_partition();
+	nvram_sync();
 }
 
 void nvram_debug(void)
@@ -617,6 +705,11 @@ void nvram_debug(void)
 #endif
 }
 
+unsigned long nvram_get_generation(void)
+{
+	return nvram_generation;
+}
+
 unsigned int get_nvram_size(void)
 {
 	return NVRAM_LENGTH;
@@ -61,8 +61,10 @@ void reset_nvram(void);
 void wipe_nvram(void);
 void nvram_debug(void);
 void nvram_init(uint32_t store_token, uint32_t fetch_token,
-		long nv_size, void* nvram_addr);
+		long nv_size, void* nvram_addr, void *shadow_addr);
+void nvram_sync(void);
 unsigned int get_nvram_size(void);
+unsigned long nvram_get_generation(void);
 
 /* envvar.c */
 char *get_env(partition_t part, char *envvar);
@@ -63,7 +63,12 @@ struct virtio_net_hdr {
 	// uint16_t  num_buffers;	/* Only if VIRTIO_NET_F_MRG_RXBUF */
 };
 
+/* Definitions for virtio_net_hdr.flags */
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	1
+
 static uint16_t last_rx_idx;	/* Last index in RX "used" ring */
+static int guest_features;	/* Features negotiated with the device */
+static int tx_csum;		/* Client wants UDP checksums offloaded */
 
 /**
  * Module init for virtio via PCI.
@@ -141,8 +146,11 @@ static int virtionet_init(net_driver_t *driver)
 	/* Tell HV that we know how to drive the device. */
 	virtio_set_status(&virtiodev, VIRTIO_STAT_ACKNOWLEDGE|VIRTIO_STAT_DRIVER);
 
-	/* Device specific setup - we do not support special features right now */
-	virtio_set_guest_features(&virtiodev,  0);
+	/* Device specific setup - the only feature we use is TX checksum
+	 * offload, which is harmless for clients that do not ask for it */
+	guest_features = virtio_get_host_features(&virtiodev) & VIRTIO_NET_F_CSUM;
+	virtio_set_guest_features(&virtiodev, guest_features);
+	tx_csum = 0;
 
 	/* Allocate memory for one transmit an multiple receive buffers */
 	vq[VQ_RX].buf_mem = SLOF_alloc_mem((BUFFER_ENTRY_SIZE+sizeof(struct virtio_net_hdr))
@@ -238,6 +246,17 @@ static int virtionet_xmit(char *buf, int len)
 
 	memset(&nethdr, 0, sizeof(nethdr));
 
+	/* Let the host complete the UDP checksum of IPv4 packets. The
+	 * client has already put the pseudo header sum into the field. */
+	if (tx_csum && len >= 14 + 20 + 8
+	    && buf[12] == 0x08 && buf[13] == 0x00	/* IPv4 */
+	    && buf[14 + 9] == 17			/* UDP */
+	    && !(buf[14 + 6] & 0x3f) && !buf[14 + 7]) {	/* no fragment */
+		nethdr.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		nethdr.csum_start = 14 + (buf[14] & 0x0f) * 4;
+		nethdr.csum_offset = 6;
+	}
+
 	/* Determine descriptor index */
 	id = (vq[VQ_TX].avail->idx * 2) % vq[VQ_TX].size;
 
@@ -367,3 +386,15 @@ int virtionet_write(char *buf, int len)
 		return virtionet_xmit(buf, len);
 	return -1;
 }
+
+/**
+ * Enable or disable UDP checksum offload for transmitted packets.
+ * Returns whether the device supports it.
+ */
+int virtionet_set_tx_csum(int enable)
+{
+	if (!(guest_features & VIRTIO_NET_F_CSUM))
+		return 0;
+	tx_csum = enable;
+	return 1;
+}
@@ -18,6 +18,9 @@
 #define RX_QUEUE_SIZE		16
 #define BUFFER_ENTRY_SIZE	1514
 
+/* Feature bits */
+#define VIRTIO_NET_F_CSUM	(1 << 0)	/* Device handles partial csum */
+
 enum {
 	VQ_RX = 0,	/* Receive Queue */
 	VQ_TX = 1,	/* Transmit Queue */
@@ -39,5 +42,6 @@ extern net_driver_t *virtionet_open(char *mac_addr, int len, struct virtio_devic
 extern void virtionet_close(net_driver_t *driver);
 extern int virtionet_read(char *buf, int len);
 extern int virtionet_write(char *buf, int len);
+extern int virtionet_set_tx_csum(int enable);
 
 #endif
@@ -155,6 +155,21 @@ void virtio_set_status(struct virtio_device *dev, int status)
 }
 
 
+/**
+ * Get feature bits offered by the device
+ */
+int virtio_get_host_features(struct virtio_device *dev)
+{
+	int features = 0;
+
+	if (dev->type == VIRTIO_TYPE_PCI) {
+		features = le32_to_cpu(ci_read_32(dev->base+VIRTIOHDR_DEVICE_FEATURES));
+	}
+
+	return features;
+}
+
+
 /**
  * Set guest feature bits
  */
@@ -162,7 +177,8 @@ void virtio_set_guest_features(struct virtio_device *dev, int features)
 
 {
 	if (dev->type == VIRTIO_TYPE_PCI) {
-		ci_write_32(dev->base+VIRTIOHDR_GUEST_FEATURES, features);
+		ci_write_32(dev->base+VIRTIOHDR_GUEST_FEATURES,
+			    cpu_to_le32(features));
 	}
 }
 
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*
+ * Slicing-by-8 CRC-32 of the flash image, see crc32.h. This file is linked
+ * into the js2x stage2 and RTAS, and compiled for build_romfs on the host.
+ */
+
+#include <crc32.h>
+
+uint32_t crc32_table[8][256];
+
+void
+crc32_init(void)
+{
+	uint32_t crc;
+	int i, j;
+
+	if (crc32_table[0][1])
+		return;
+
+	for (i = 0; i < 256; i++) {
+		crc = (uint32_t) i << 24;
+		for (j = 0; j < 8; j++)
+			crc = (crc << 1) ^ (crc & 0x80000000 ? CRC32_GENERATOR : 0);
+		crc32_table[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			crc32_table[j][i] = (crc32_table[j - 1][i] << 8) ^
+			    crc32_table[0][crc32_table[j - 1][i] >> 24];
+}
+
+uint32_t
+crc32_update(uint32_t crc, const unsigned char *buf, unsigned long len)
+{
+	crc32_init();
+
+	for (; len >= 8; len -= 8, buf += 8)
+		crc = crc32_update64(crc,
+				     ((uint64_t) buf[0] << 56) |
+				     ((uint64_t) buf[1] << 48) |
+				     ((uint64_t) buf[2] << 40) |
+				     ((uint64_t) buf[3] << 32) |
+				     ((uint64_t) buf[4] << 24) |
+				     ((uint64_t) buf[5] << 16) |
+				     ((uint64_t) buf[6] << 8) | buf[7]);
+	while (len--)
+		crc = crc32_update8(crc, *buf++);
+
+	return crc;
+}
@@ -18,9 +18,14 @@
 #include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include <cfgparse.h>
 #include <createcrc.h>
+#include <crc32.h>
+#include <lz4.h>
 
 #define FFS_TARGET_HEADER_SIZE (4 * 8)
 
@@ -58,6 +63,304 @@ file_getsize(const char *name)
 	return fi.st_size;
 }
 
+/* directory with packed files of earlier builds, see compress_files() */
+static const char *cache_dir;
+
+static int
+read_image(const char *name, unsigned char *buf, int size)
+{
+	int fd, cnt, i;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0) {
+		perror(name);
+		return -1;
+	}
+	for (cnt = 0; cnt < size; cnt += i) {
+		i = read(fd, buf + cnt, size - cnt);
+		if (i <= 0) {
+			printf("read error on image file [%s]\n", name);
+			close(fd);
+			return -1;
+		}
+	}
+	close(fd);
+	return 0;
+}
+
+/* 64 bit FNV-1a hash of the file contents, used as cache key */
+static uint64_t
+hash_data(const unsigned char *p, int len)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (len--) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/*
+ * A cache file starts with a header that describes the unpacked data,
+ * followed by the LZ4 block (nothing if the data is incompressible).
+ * The header is in host byte order, a cache written on a host with the
+ * other byte order just does not match.
+ */
+#define CACHE_MAGIC	0x534c5a34	/* "SLZ4" */
+
+struct cache_header {
+	uint32_t magic;
+	uint32_t size;		/* length of the unpacked data */
+	uint32_t crc;		/* crc32_update() of the unpacked data */
+	uint32_t zlen;		/* length of the LZ4 block */
+};
+
+/**
+ * load a packed LZ4 block from the cache; returns its length, 0 if the
+ * data has been found to be incompressible and -1 if it is not cached.
+ * A cached block is only used if it unpacks to exactly the data in buf.
+ */
+static int
+cache_load(const char *path, const unsigned char *buf, int size,
+	   uint32_t crc, unsigned char *zbuf, int maxlen)
+{
+	struct cache_header ch;
+	unsigned char *check;
+	int fd, len;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	len = -1;
+	if (read(fd, &ch, sizeof(ch)) != (ssize_t) sizeof(ch)
+	    || ch.magic != CACHE_MAGIC
+	    || ch.size != (uint32_t) size
+	    || ch.crc != crc
+	    || ch.zlen > (uint32_t) maxlen
+	    || file_getsize(path) != (int) (sizeof(ch) + ch.zlen))
+		goto out;
+	len = ch.zlen;
+	if (len == 0 || read(fd, zbuf, len) != len) {
+		len = len ? -1 : 0;
+		goto out;
+	}
+
+	check = malloc(size);
+	if (!check
+	    || lz4_decompress(zbuf, len, check, size) != size
+	    || memcmp(check, buf, size))
+		len = -1;
+	free(check);
+out:
+	close(fd);
+	return len;
+}
+
+/**
+ * store a packed LZ4 block in the cache; the file is written under a
+ * temporary name first, so that concurrent builds never see partial files
+ */
+static void
+cache_store(const char *path, int size, uint32_t crc,
+	    const unsigned char *zbuf, int len)
+{
+	struct cache_header ch;
+	char tmp[PATH_MAX];
+	int fd;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int) sizeof(tmp))
+		return;
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		return;
+	fchmod(fd, 0644);
+	ch.magic = CACHE_MAGIC;
+	ch.size = size;
+	ch.crc = crc;
+	ch.zlen = len;
+	if (write(fd, &ch, sizeof(ch)) != (ssize_t) sizeof(ch)
+	    || write(fd, zbuf, len) != len) {
+		close(fd);
+		unlink(tmp);
+		return;
+	}
+	close(fd);
+	if (rename(tmp, path))
+		unlink(tmp);
+}
+
+/**
+ * pack the image file of an entry with FLAG_COMPRESSED set; the packed
+ * data starts with the unpacked size (8 bytes, big endian) followed by an
+ * LZ4 block. Files that do not get smaller are stored uncompressed and
+ * lose the flag, and so do files which are used by the low level firmware,
+ * since it cannot unpack them.
+ */
+static int
+compress_file(struct ffs_header_t *hdr)
+{
+	char path[PATH_MAX];
+	unsigned char *buf, *zbuf;
+	int size, zlen = -1;
+	uint32_t crc;
+
+	if (needs_fix_offset(hdr)) {
+		printf("[%s] WARNING: low level firmware cannot be "
+		       "compressed\n", hdr->token);
+		hdr->flags &= ~FLAG_COMPRESSED;
+		return 0;
+	}
+
+	size = file_getsize(hdr->imagefile);
+	if (size == -1) {
+		perror(hdr->imagefile);
+		return -1;
+	}
+
+	buf = malloc(size + 1);
+	zbuf = malloc(size + 8);
+	if (!buf || !zbuf) {
+		perror("alloc mem for compression");
+		goto fail;
+	}
+	if (read_image(hdr->imagefile, buf, size))
+		goto fail;
+
+	if (cache_dir) {
+		crc = crc32_update(0, buf, size);
+		snprintf(path, sizeof(path), "%s/%016llx-%08x-%x.lz4",
+			 cache_dir, (unsigned long long) hash_data(buf, size),
+			 crc, size);
+		zlen = cache_load(path, buf, size, crc, zbuf + 8, size - 8);
+		if (zlen == 0)
+			zlen = -1;	/* known to be incompressible */
+		else if (zlen < 0) {
+			zlen = lz4_compress(buf, size, zbuf + 8, size - 8);
+			cache_store(path, size, crc, zbuf + 8,
+				    zlen < 0 ? 0 : zlen);
+		}
+	} else
+		zlen = lz4_compress(buf, size, zbuf + 8, size - 8);
+
+	free(buf);
+	if (zlen < 0) {
+		free(zbuf);
+		hdr->flags &= ~FLAG_COMPRESSED;
+		return 0;
+	}
+
+	*(uint64_t *) zbuf = cpu_to_be64((uint64_t) size);
+	hdr->zdata = zbuf;
+	hdr->zdata_len = zlen + 8;
+	if (verbose)
+		printf("[%s] compressed %d -> %d bytes\n", hdr->token, size,
+		       hdr->zdata_len);
+	return 0;
+
+fail:
+	free(buf);
+	free(zbuf);
+	return -1;
+}
+
+struct compress_queue {
+	pthread_mutex_t lock;
+	struct ffs_header_t **tab;
+	int count;
+	int next;
+	int rc;
+};
+
+static void *
+compress_worker(void *arg)
+{
+	struct compress_queue *q = arg;
+	struct ffs_header_t *hdr;
+	int rc;
+
+	while (1) {
+		pthread_mutex_lock(&q->lock);
+		hdr = q->next < q->count ? q->tab[q->next++] : NULL;
+		pthread_mutex_unlock(&q->lock);
+		if (!hdr)
+			return NULL;
+		rc = compress_file(hdr);
+		if (rc) {
+			pthread_mutex_lock(&q->lock);
+			q->rc = rc;
+			pthread_mutex_unlock(&q->lock);
+		}
+	}
+}
+
+/**
+ * pack all entries with FLAG_COMPRESSED set, using up to jobs threads;
+ * if cache is not NULL, packed files are kept in that directory, named
+ * after a hash and the CRC of their contents, and reused by later builds
+ * if they unpack to the same data
+ */
+int
+compress_files(struct ffs_chain_t *fs, int jobs, const char *cache)
+{
+	struct compress_queue q;
+	struct ffs_header_t *hdr;
+	pthread_t threads[MAX_COMPRESS_JOBS];
+	int i, started;
+
+	/* create_flash rejects -j outside of this range */
+	if (jobs < 1 || jobs > MAX_COMPRESS_JOBS)
+		return -1;
+
+	/* the CRC tables must not be set up by several threads at once */
+	crc32_init();
+
+	cache_dir = cache;
+	if (cache_dir && mkdir(cache_dir, 0777) && errno != EEXIST) {
+		perror(cache_dir);
+		cache_dir = NULL;
+	}
+
+	memset(&q, 0, sizeof(q));
+	q.tab = malloc(fs->count * sizeof(*q.tab));
+	if (!q.tab)
+		return -1;
+	for (hdr = fs->first; hdr; hdr = hdr->next)
+		if ((hdr->flags & FLAG_COMPRESSED) && !hdr->zdata)
+			q.tab[q.count++] = hdr;
+	pthread_mutex_init(&q.lock, NULL);
+
+	if (jobs > q.count)
+		jobs = q.count;
+
+	for (started = 0; started < jobs - 1; started++)
+		if (pthread_create(&threads[started], NULL, compress_worker,
+				   &q))
+			break;
+	/* the main thread works on the queue as well */
+	compress_worker(&q);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&q.lock);
+	free(q.tab);
+	return q.rc;
+}
+
+/**
+ * size of the data which goes into the romfs for this entry
+ */
+static int
+ffs_data_size(struct ffs_header_t *hdr)
+{
+	if ((hdr->flags & FLAG_COMPRESSED) && !hdr->zdata &&
+	    compress_file(hdr))
+		return -1;
+	if (hdr->zdata)
+		return hdr->zdata_len;
+	return file_getsize(hdr->imagefile);
+}
+
 static int
 ffshdr_compare(const void *_a, const void *_b)
 {
@@ -101,7 +404,7 @@ reorder_ffs_chain(struct ffs_chain_t *fs)
 		if (hdr->linked_to)
 			hdr->imagefile_length = 0;
 		else
-			hdr->imagefile_length = file_getsize(hdr->imagefile);
+			hdr->imagefile_length = ffs_data_size(hdr);
 		if (hdr->imagefile_length == -1)
 			return -1;
 
@@ -370,7 +673,7 @@ build_ffs(struct ffs_chain_t *fs, const char *outfile, int notime)
 		/* add +1 to strlen for zero termination */
 		tokensize = pad8_num(strlen(hdr->token) + 1);
 		hdrsize = FFS_TARGET_HEADER_SIZE + tokensize;
-		datasize = file_getsize(hdr->imagefile);
+		datasize = ffs_data_size(hdr);
 
 		if (datasize == -1) {
 			perror(hdr->imagefile);
@@ -434,7 +737,12 @@ build_ffs(struct ffs_chain_t *fs, const char *outfile, int notime)
 		ffile_offset += tokensize;
 
 		/* image file ********************************************* */
-		i = copy_file(hdr, ffile, datasize, ffile_offset, ffsize);
+		if (hdr->zdata) {
+			memcpy(ffile + ffile_offset, hdr->zdata, datasize);
+			i = datasize;
+		} else
+			i = copy_file(hdr, ffile, datasize, ffile_offset,
+				      ffsize);
 
 		if (i == -1)
 			return 1;
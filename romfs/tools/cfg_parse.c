@@ -330,6 +330,9 @@ free_chain_memory(struct ffs_chain_t *chain)
 		if (NULL != hdr->imagefile) {
 			free(hdr->imagefile);
 		}
+		if (NULL != hdr->zdata) {
+			free(hdr->zdata);
+		}
 		next_hdr = hdr->next;
 		free(hdr);
 		hdr = next_hdr;
@@ -28,6 +28,7 @@ struct ffs_chain_t {
 };
 
 #define FLAG_LLFW 1		/* low level firmware at fix offs in romfs */
+#define FLAG_COMPRESSED 2	/* LZ4 compressed, unpacked by romfs-lookup */
 
 #define needs_fix_offset(hdr) ((hdr)->flags & FLAG_LLFW)
 
@@ -42,6 +43,8 @@ struct ffs_header_t {
 	unsigned long long save_data;
 	unsigned long long save_data_len;
 	int save_data_valid;
+	unsigned char *zdata;	/* compressed contents (FLAG_COMPRESSED) */
+	int zdata_len;
 
 	unsigned long long addr;	/* tmp */
 	int hdrsize;		/* tmp */
@@ -56,4 +59,8 @@ void free_chain_memory(struct ffs_chain_t *chain);
 int read_config(int conf_file, struct ffs_chain_t *ffs_chain);
 int reorder_ffs_chain(struct ffs_chain_t *fs);
 int build_ffs(struct ffs_chain_t *fs, const char *outfile, int notime);
+#define MAX_COMPRESS_JOBS 64
+int compress_files(struct ffs_chain_t *fs, int jobs, const char *cache);
+int lz4_compress(const unsigned char *src, int len, unsigned char *dst,
+		 int dstlen);
 #endif
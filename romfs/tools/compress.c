@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*
+ * Compressor for romfs files with FLAG_COMPRESSED set.
+ *
+ * The output is a plain LZ4 block (no frame header): a sequence of tokens,
+ * each one consisting of a run of literals followed by a back reference
+ * into the 64 KiB of data already produced. The block format rules are
+ * followed so that any LZ4 block decoder can unpack it (the last five bytes
+ * are literals, the last match starts at least 12 bytes before the end).
+ * The firmware side decoder lives in slof/lz4.c.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cfgparse.h>
+
+#define LZ4_MIN_MATCH		4
+#define LZ4_LAST_LITERALS	5
+#define LZ4_MF_LIMIT		12
+#define LZ4_MAX_OFFSET		0xffff
+#define LZ4_HASH_BITS		16
+
+static uint32_t
+read32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static unsigned int
+lz4_hash(const unsigned char *p)
+{
+	return (read32(p) * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+/* store a length >= 15 as a sequence of 255 bytes plus a remainder */
+static unsigned char *
+put_length(unsigned char *op, unsigned char *oend, int len)
+{
+	for (len -= 15; len >= 255; len -= 255) {
+		if (op >= oend)
+			return NULL;
+		*op++ = 255;
+	}
+	if (op >= oend)
+		return NULL;
+	*op++ = len;
+	return op;
+}
+
+static unsigned char *
+put_sequence(unsigned char *op, unsigned char *oend,
+	     const unsigned char *lit, int litlen, int offset, int matchlen)
+{
+	unsigned char *token;
+
+	if (op >= oend)
+		return NULL;
+	token = op++;
+
+	*token = (litlen >= 15 ? 15 : litlen) << 4;
+	if (litlen >= 15 && !(op = put_length(op, oend, litlen)))
+		return NULL;
+	if (op + litlen > oend)
+		return NULL;
+	memcpy(op, lit, litlen);
+	op += litlen;
+
+	/* the final sequence has literals only */
+	if (!matchlen)
+		return op;
+
+	if (op + 2 > oend)
+		return NULL;
+	*op++ = offset & 0xff;
+	*op++ = offset >> 8;
+
+	matchlen -= LZ4_MIN_MATCH;
+	*token |= matchlen >= 15 ? 15 : matchlen;
+	if (matchlen >= 15)
+		op = put_length(op, oend, matchlen);
+	return op;
+}
+
+/**
+ * compress len bytes from src into dst (which can hold dstlen bytes)
+ * returns the size of the compressed block or -1 if it does not fit
+ */
+int
+lz4_compress(const unsigned char *src, int len, unsigned char *dst, int dstlen)
+{
+	int *table;
+	const unsigned char *ip = src, *anchor = src;
+	const unsigned char *mflimit = src + len - LZ4_MF_LIMIT;
+	const unsigned char *matchlimit = src + len - LZ4_LAST_LITERALS;
+	unsigned char *op = dst, *oend = dst + dstlen;
+	int i;
+
+	/* allocated per call, build_romfs compresses in several threads */
+	table = malloc(sizeof(*table) << LZ4_HASH_BITS);
+	if (!table)
+		return -1;
+	for (i = 0; i < (1 << LZ4_HASH_BITS); i++)
+		table[i] = -1;
+
+	while (len >= LZ4_MF_LIMIT + 1 && ip < mflimit) {
+		const unsigned char *ref, *p;
+		unsigned int h = lz4_hash(ip);
+
+		ref = table[h] < 0 ? NULL : src + table[h];
+		table[h] = ip - src;
+
+		if (!ref || ip - ref > LZ4_MAX_OFFSET ||
+		    read32(ref) != read32(ip)) {
+			ip++;
+			continue;
+		}
+
+		/* extend the match backwards into pending literals ... */
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+		/* ... and forwards up to the last literals */
+		p = ip + LZ4_MIN_MATCH;
+		while (p < matchlimit && *p == ref[p - ip])
+			p++;
+
+		op = put_sequence(op, oend, anchor, ip - anchor, ip - ref,
+				  p - ip);
+		if (!op)
+			break;
+
+		/* seed the table with the position inside the match */
+		if (p - 2 >= src && p - 2 < mflimit)
+			table[lz4_hash(p - 2)] = p - 2 - src;
+		ip = anchor = p;
+	}
+
+	if (op)
+		op = put_sequence(op, oend, anchor, src + len - anchor, 0, 0);
+	free(table);
+	if (!op)
+		return -1;
+	return op - dst;
+}
@@ -23,13 +23,11 @@
 #include <cfgparse.h>
 #include <time.h>
 #include <calculatecrc.h>
+#include <crc32.h>
 #include <product.h>
 #include "createcrc.h"
 
 int createHeaderImage(int);
-unsigned int calCRCEthernet32(unsigned char *TextPtr,
-			      unsigned long int TextLength,
-			      unsigned int AccumCRC);
 int createCRCParameter(uint64_t * ui64RegisterMask,
 		       unsigned int *iRegisterLength);
 uint64_t calCRCbyte(unsigned char *TextPtr, uint32_t Residual,
@@ -178,43 +176,6 @@ createHeaderImage(int notime)
 	return 0;
 }
 
-/**
- * calculate standart ethernet 32 bit CRC
- * generator polynome is 0x104C11DB7
- * this algorithm can be used for encoding and decoding
- */
-unsigned int
-calCRCEthernet32(unsigned char *TextPtr, unsigned long int TextLength,
-		 unsigned int AccumCRC)
-{
-	const unsigned int CrcTableHigh[16] = {
-		0x00000000, 0x4C11DB70, 0x9823B6E0, 0xD4326D90,
-		0x34867077, 0x7897AB07, 0xACA5C697, 0xE0B41DE7,
-		0x690CE0EE, 0x251D3B9E, 0xF12F560E, 0xBD3E8D7E,
-		0x5D8A9099, 0x119B4BE9, 0xC5A92679, 0x89B8FD09
-	};
-	const unsigned CrcTableLow[16] = {
-		0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
-		0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
-		0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
-		0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
-	};
-
-	unsigned char *Buffer = TextPtr;
-	unsigned long int Residual = TextLength;
-
-
-	while (Residual > 0) {
-		unsigned int Temp = ((AccumCRC >> 24) ^ *Buffer) & 0x000000ff;
-		AccumCRC <<= 8;
-		AccumCRC ^= CrcTableHigh[Temp / 16];
-		AccumCRC ^= CrcTableLow[Temp % 16];
-		++Buffer;
-		--Residual;
-	}
-	return AccumCRC;
-}
-
 /**
  * create CRC Parameter:  CRC Polynome, Shiftregister Mask and length
  *
@@ -405,20 +366,21 @@ checkCRC(unsigned char *cPtr, uint32_t ui32NoWords, uint64_t AccumCRC)
 			/* (ui32NoWords - 4),no need of 4 bytes 0x as
 			 * with shift-register method */
 			AccumCRC =
-			    calCRCEthernet32(cPtr, (ui32NoWords - 4), AccumCRC);
+			    crc32_update(AccumCRC, cPtr, (ui32NoWords - 4));
 			break;
 		}
 	default:{
 			AccumCRC = calCRCword(cPtr, ui32NoWords, AccumCRC);
+			if (calCRCbyte(cPtr, ui32NoWords, ui64Buffer) !=
+			    AccumCRC) {
+				printf("\n --- big Endian - small Endian "
+				       "problem --- \n");
+				AccumCRC--;
+			}
 			break;
 		}
 	}
 
-	if (calCRCbyte(cPtr, ui32NoWords, ui64Buffer) != AccumCRC) {
-		printf("\n --- big Endian - small Endian problem --- \n");
-		AccumCRC--;
-	}
-
 	return (AccumCRC);
 }
 
@@ -448,9 +410,9 @@ writeDataStream(int iofd, int notime)
 	*(uint64_t *) (pucFileStream + ui64globalFileSize - 8) =
 	    cpu_to_be64(ui64FileCRC);
 
-	/* check CRC-implementation */
-	ui64HeaderCRC = calCRCword(pucFileStream, ui64globalHeaderSize, 0);
-	ui64FileCRC = calCRCword(pucFileStream, ui64globalFileSize, 0);
+	/* check CRC-implementation: the CRC over data and appended CRC is 0 */
+	ui64HeaderCRC = crc32_update(0, pucFileStream, ui64globalHeaderSize);
+	ui64FileCRC = crc32_update(0, pucFileStream, ui64globalFileSize);
 
 	if ((ui64HeaderCRC != 0) || (ui64FileCRC != 0)) {
 		printf("\n\n %s \n %s \n\n", "CRCs not correct implemented.",
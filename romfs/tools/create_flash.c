@@ -29,7 +29,8 @@ print_usage(void)
 {
 	printf
 	    ("Usage: build_romfs [-?] [--help] [-s|--romfs-size <romfs_size>]\n"
-	     "\t[-p|--smart-pad] [-n|--notime] <config-file> <output-file>\n");
+	     "\t[-p|--smart-pad] [-n|--notime] [-j|--jobs <n>]\n"
+	     "\t[-c|--cache <dir>] <config-file> <output-file>\n");
 }
 
 unsigned long
@@ -60,6 +61,8 @@ main(int argc, char *argv[])
 	int c;
 	int smart_pad = 0;	/* default */
 	int notime = 0;
+	int jobs = 1;
+	const char *cache = NULL;
 	const char *config_file = "boot_rom.ffs";
 	const char *output_file = "boot_rom.bin";
 
@@ -72,10 +75,12 @@ main(int argc, char *argv[])
 			{"smart-pad", 0, 0, 'p'},
 			{"notime", 0, 0, 'n'},
 			{"verbose", 0, 0, 'v'},
+			{"jobs", 1, 0, 'j'},
+			{"cache", 1, 0, 'c'},
 			{"help", 1, 0, 'h'},
 			{0, 0, 0, 0}
 		};
-		c = getopt_long(argc, argv, "s:ph?nv", long_options,
+		c = getopt_long(argc, argv, "s:ph?nvj:c:", long_options,
 				&option_index);
 		if (c == -1)
 			break;
@@ -93,6 +98,24 @@ main(int argc, char *argv[])
 		case 'v':
 			verbose = 1;
 			break;
+		case 'j':
+			{
+				char *end;
+				long val = strtol(optarg, &end, 0);
+
+				if (end == optarg || *end || val < 1
+				    || val > MAX_COMPRESS_JOBS) {
+					fprintf(stderr, "invalid number of "
+						"jobs: %s (1..%d)\n", optarg,
+						MAX_COMPRESS_JOBS);
+					return EXIT_FAILURE;
+				}
+				jobs = val;
+				break;
+			}
+		case 'c':
+			cache = optarg;
+			break;
 		case '?':
 		case 'h':
 			print_usage();
@@ -133,6 +156,13 @@ main(int argc, char *argv[])
 
 	if (verbose)
 		dump_fs_contents(&ffs_chain);
+
+	/* pack compressed files up front, so that it can be done in parallel */
+	if (compress_files(&ffs_chain, jobs, cache) != 0) {
+		rc = EXIT_FAILURE;
+		goto out;
+	}
+
 	if (smart_pad)
 		/* FIXME: size is only verified during reorder */
 		rc = reorder_ffs_chain(&ffs_chain);
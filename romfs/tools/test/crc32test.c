@@ -0,0 +1,139 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+
+/*
+ * Host test for include/crc32.h: the slicing-by-8 CRC must give the same
+ * results as the nibble-table function that build_romfs, stage2 and RTAS
+ * used before, for random buffers, alignments, lengths and start values.
+ * Both the crc32_update() path of build_romfs and the firmware path
+ * (bytewise head and tail, 64 bit loads in between) are checked.
+ *
+ * Usage: crc32test [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <crc32.h>
+
+#define BUF_SIZE	(1 << 20)
+
+/* the former calCRCEthernet32() of create_crc.c */
+static uint32_t
+crc32_nibble(const unsigned char *buf, unsigned long len, uint32_t crc)
+{
+	static const uint32_t high[16] = {
+		0x00000000, 0x4C11DB70, 0x9823B6E0, 0xD4326D90,
+		0x34867077, 0x7897AB07, 0xACA5C697, 0xE0B41DE7,
+		0x690CE0EE, 0x251D3B9E, 0xF12F560E, 0xBD3E8D7E,
+		0x5D8A9099, 0x119B4BE9, 0xC5A92679, 0x89B8FD09
+	};
+	static const uint32_t low[16] = {
+		0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
+		0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+		0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+		0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
+	};
+	uint32_t tmp;
+
+	while (len-- > 0) {
+		tmp = ((crc >> 24) ^ *buf++) & 0xff;
+		crc <<= 8;
+		crc ^= high[tmp / 16];
+		crc ^= low[tmp % 16];
+	}
+
+	return crc;
+}
+
+static uint64_t
+load64_be(const unsigned char *p)
+{
+	uint64_t val = 0;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		val = (val << 8) | p[i];
+
+	return val;
+}
+
+/* like the flash check of stage2 and RTAS */
+static uint32_t
+crc32_firmware(const unsigned char *buf, unsigned long len, uint32_t crc)
+{
+	crc32_init();
+
+	while (len > 0 && ((uintptr_t) buf & 7)) {
+		crc = crc32_update8(crc, *buf++);
+		len--;
+	}
+	for (; len >= 8; len -= 8, buf += 8)
+		crc = crc32_update64(crc, load64_be(buf));
+	while (len-- > 0)
+		crc = crc32_update8(crc, *buf++);
+
+	return crc;
+}
+
+int
+main(int argc, char *argv[])
+{
+	long i, iterations = 200000;
+	unsigned long off, len;
+	uint32_t start, ref;
+	unsigned char *buf;
+
+	if (argc > 1)
+		iterations = atol(argv[1]);
+
+	buf = malloc(BUF_SIZE);
+	if (!buf) {
+		printf("crc32test: out of memory\n");
+		return 1;
+	}
+
+	srand(1);
+	for (i = 0; i < BUF_SIZE; i++)
+		buf[i] = rand();
+
+	for (i = 0; i < iterations; i++) {
+		off = rand() % 4096;
+		/* a few long buffers, then many short ones */
+		len = rand() % (i < 1000 ? 70000 : 300);
+		start = i & 1 ? (uint32_t) rand() : 0;
+
+		ref = crc32_nibble(buf + off, len, start);
+		if (crc32_update(start, buf + off, len) != ref
+		    || crc32_firmware(buf + off, len, start) != ref) {
+			printf("crc32test: mismatch at offset %lu, length %lu, "
+			       "start 0x%08x\n", off, len, start);
+			free(buf);
+			return 1;
+		}
+	}
+
+	/* the whole buffer, in one piece and in two */
+	ref = crc32_nibble(buf, BUF_SIZE, 0);
+	if (crc32_update(0, buf, BUF_SIZE) != ref
+	    || crc32_update(crc32_update(0, buf, 12345), buf + 12345,
+			    BUF_SIZE - 12345) != ref) {
+		printf("crc32test: mismatch over %d bytes\n", BUF_SIZE);
+		free(buf);
+		return 1;
+	}
+
+	printf("crc32test: %ld random checks passed\n", iterations);
+	free(buf);
+
+	return 0;
+}
@@ -37,6 +37,8 @@ struct bitmap {
 	unsigned long bm_size;
 	unsigned long block_size;
 	unsigned long free_blocks;
+	unsigned long hint;	/* next-fit: bit to start the next search at */
+	unsigned long *sum;	/* summary: one bit per bmw word that has free bits */
 	unsigned long bmw[];
 };
 
@@ -44,6 +46,7 @@ struct bitmap {
 #define BM_WORD(bmw, n) (bmw[n/BM_WORD_BITS])
 #define BM_WORD_MODULO(n)  (n % BM_WORD_BITS)
 #define BM_NUM_BITS(reqsize, bsize)     ((reqsize / bsize) + (reqsize % bsize? 1 : 0))
+#define BM_NUM_WORDS(n_bits)	(((n_bits) + BM_WORD_BITS - 1) / BM_WORD_BITS)
 
 void bm_clear_bit(unsigned long *bmw, int n)
 {
@@ -63,30 +66,134 @@ bool bm_test_bit(unsigned long *bmw, int n)
 	return !!(BM_WORD(bmw, n) & BIT(BM_WORD_MODULO(n)));
 }
 
-/* Improvement: can use FFS routines to get faster results */
-int bm_find_bits(struct bitmap *bm, unsigned int n_bits)
+/* Mask with the bits from..to-1 of a word set (0 <= from < to <= BM_WORD_BITS) */
+static inline unsigned long bm_mask(unsigned long from, unsigned long to)
 {
-	unsigned int i, j, total_bits;
-	int found = -1;
-	dprintf("Finding %d bits set\n", n_bits);
-	total_bits = BM_NUM_BITS(bm->size, bm->block_size);
-	for(i = 0; i < total_bits; i++) {
-		if (!bm_test_bit(bm->bmw, i))
-			continue;
-		/* we have hit the boundary now, give up */
-		if (i + n_bits > total_bits)
-			break;
-		/* Lets find if we have consecutive bits set */
-		for(j = i; j < (i + n_bits); j++) {
-			if (!bm_test_bit(bm->bmw, (j)))
-				break;
+	unsigned long mask = ~0UL << from;
+
+	if (to < BM_WORD_BITS)
+		mask &= ~(~0UL << to);
+	return mask;
+}
+
+static void bm_update_sum(struct bitmap *bm, unsigned long w)
+{
+	if (bm->bmw[w])
+		bm_set_bit(bm->sum, w);
+	else
+		bm_clear_bit(bm->sum, w);
+}
+
+/* Set (free) or clear (allocate) the bits first..first+n_bits-1 */
+static void bm_change_bits(struct bitmap *bm, unsigned long first,
+			   unsigned long n_bits, bool set)
+{
+	unsigned long end = first + n_bits;
+
+	while (first < end) {
+		unsigned long w = first / BM_WORD_BITS;
+		unsigned long to = end - w * BM_WORD_BITS;
+		unsigned long mask;
+
+		if (to > BM_WORD_BITS)
+			to = BM_WORD_BITS;
+		mask = bm_mask(BM_WORD_MODULO(first), to);
+#ifdef DEBUG
+		if (set && (bm->bmw[w] & mask))
+			dprintf("Warning: Bit already set in word %ld\n", w);
+		if (!set && (~bm->bmw[w] & mask))
+			dprintf("Warning: Bit already in use in word %ld\n", w);
+#endif
+		if (set)
+			bm->bmw[w] |= mask;
+		else
+			bm->bmw[w] &= ~mask;
+		bm_update_sum(bm, w);
+		first = (w + 1) * BM_WORD_BITS;
+	}
+}
+
+/*
+ * Return the number of the first bit >= n that has the value "set",
+ * or total_bits if there is none.  Words without any free bit are
+ * skipped with the help of the summary bitmap when searching for a set
+ * bit, so that large, mostly allocated windows are scanned quickly.
+ */
+static unsigned long bm_next_bit(struct bitmap *bm, unsigned long n,
+				 unsigned long total_bits, bool set)
+{
+	unsigned long n_words = BM_NUM_WORDS(total_bits);
+	unsigned long w = n / BM_WORD_BITS;
+	unsigned long val;
+
+	if (n >= total_bits)
+		return total_bits;
+
+	val = set ? bm->bmw[w] : ~bm->bmw[w];
+	val &= ~0UL << BM_WORD_MODULO(n);
+	while (!val) {
+		if (++w >= n_words)
+			return total_bits;
+		if (set) {
+			/* Look for the next word with free bits in the summary */
+			unsigned long s = w / BM_WORD_BITS;
+			unsigned long sval = bm->sum[s] & (~0UL << BM_WORD_MODULO(w));
+
+			while (!sval) {
+				if (++s >= BM_NUM_WORDS(n_words))
+					return total_bits;
+				sval = bm->sum[s];
+			}
+			w = s * BM_WORD_BITS + __builtin_ctzl(sval);
+			if (w >= n_words)
+				return total_bits;
+			val = bm->bmw[w];
+		} else {
+			val = ~bm->bmw[w];
 		}
-		/* Got it */
-		if (j == (i + n_bits)) {
-			found = i;
+	}
+
+	n = w * BM_WORD_BITS + __builtin_ctzl(val);
+	return n < total_bits ? n : total_bits;
+}
+
+/*
+ * Find n_bits consecutive set (free) bits whose first bit lies within
+ * from..limit-1.  Works on whole words: the next free bit is found with
+ * count-trailing-zeros, then the end of that free run the same way.
+ */
+static long bm_find_run(struct bitmap *bm, unsigned long n_bits,
+			unsigned long from, unsigned long limit,
+			unsigned long total_bits)
+{
+	unsigned long i = from, end;
+
+	while (i < limit) {
+		i = bm_next_bit(bm, i, total_bits, true);
+		if (i >= limit || i + n_bits > total_bits)
 			break;
-		}
+		end = bm_next_bit(bm, i, i + n_bits, false);
+		if (end - i >= n_bits)
+			return i;
+		i = end;
 	}
+	return -1;
+}
+
+int bm_find_bits(struct bitmap *bm, unsigned int n_bits)
+{
+	unsigned long total_bits;
+	long found;
+
+	dprintf("Finding %d bits set\n", n_bits);
+	total_bits = BM_NUM_BITS(bm->size, bm->block_size);
+	if (bm->hint >= total_bits)
+		bm->hint = 0;
+
+	/* Next-fit: start behind the last allocation, then wrap around */
+	found = bm_find_run(bm, n_bits, bm->hint, total_bits, total_bits);
+	if (found == -1 && bm->hint)
+		found = bm_find_run(bm, n_bits, 0, bm->hint, total_bits);
 	return found;
 }
 
@@ -116,7 +223,7 @@ unsigned long SLOF_bm_allocator_init(unsigned long start, unsigned long size,
 				unsigned long blocksize)
 {
 	struct bitmap *bm;
-	unsigned long alloc_size, bm_size, n_bits;
+	unsigned long alloc_size, bm_size, sum_size, n_bits;
 
 	dprintf("enter start %x, size %d, block-size %d\n", start, size, blocksize);
 
@@ -126,8 +233,9 @@ unsigned long SLOF_bm_allocator_init(unsigned long start, unsigned long size,
 		blocksize = DEFAULT_BLOCK_SIZE;
 
 	n_bits = BM_NUM_BITS(size, blocksize);
-	bm_size = (n_bits / BM_WORD_BITS) + ((n_bits % BM_WORD_BITS)? 1 : 0);
-	alloc_size = sizeof(struct bitmap) + bm_size * BM_WORD_SIZE;
+	bm_size = BM_NUM_WORDS(n_bits);
+	sum_size = BM_NUM_WORDS(bm_size);
+	alloc_size = sizeof(struct bitmap) + (bm_size + sum_size) * BM_WORD_SIZE;
 	dprintf("Size %ld, blocksize %ld, bm_size %ld, alloc_size %ld\n",
 		size, blocksize, bm_size, alloc_size);
 	bm = (struct bitmap *) SLOF_alloc_mem(alloc_size);
@@ -138,7 +246,10 @@ unsigned long SLOF_bm_allocator_init(unsigned long start, unsigned long size,
 	bm->bm_size = bm_size;
 	bm->block_size = blocksize;
 	bm->free_blocks = n_bits;
-	memset(bm->bmw, 0xFF, bm_size*BM_WORD_SIZE);
+	bm->hint = 0;
+	bm->sum = &bm->bmw[bm_size];
+	memset(bm->bmw, 0, (bm_size + sum_size) * BM_WORD_SIZE);
+	bm_change_bits(bm, 0, n_bits, true);
 	return (unsigned long)bm;
 }
 
@@ -147,7 +258,6 @@ unsigned long SLOF_bm_alloc(unsigned long handle, unsigned long size)
 	struct bitmap *bm;
 	unsigned long n_bits;
 	unsigned long addr;
-	unsigned int i;
 	int bitpos;
 
 	if (!handle)
@@ -163,18 +273,13 @@ unsigned long SLOF_bm_alloc(unsigned long handle, unsigned long size)
 	if (bitpos == -1)
 		return -1;
 
-	dprintf("BMW %d, bitpos %d\n", i, bitpos);
+	dprintf("bitpos %d\n", bitpos);
 	dprintf("size %d, block_size %d, n_bits %d\n", size, bm->block_size, n_bits);
-	for(i = bitpos; i < (bitpos + n_bits); i++) {
-#ifdef DEBUG
-		if (!bm_test_bit(bm->bmw, i))
-			dprintf("Warning: Bit already in use: %d\n", i);
-#endif
-		bm_clear_bit(bm->bmw, i);
-	}
+	bm_change_bits(bm, bitpos, n_bits, false);
 	bm->free_blocks -= n_bits;
+	bm->hint = bitpos + n_bits;
 	addr = bm->start + bitpos * bm->block_size;
-	dprintf("BMW %d, bitpos %d addr %lx free_blocks %d\n", i, bitpos, addr, bm->free_blocks);
+	dprintf("bitpos %d addr %lx free_blocks %d\n", bitpos, addr, bm->free_blocks);
 	return addr;
 }
 
@@ -183,7 +288,6 @@ void SLOF_bm_free(unsigned long handle, unsigned long ptr, unsigned long size)
 	struct bitmap *bm;
 	unsigned long bitpos, n_bits;
 	unsigned long addr;
-	unsigned int i;
 
 	if (!handle)
 		return;
@@ -207,13 +311,7 @@ void SLOF_bm_free(unsigned long handle, unsigned long ptr, unsigned long size)
 	}
 #endif
 
-	for(i = bitpos; i < (bitpos + n_bits); i++) {
-#ifdef DEBUG
-		if (bm_test_bit(bm->bmw, i))
-			dprintf("Warning: Bit already set: %d\n", i);
-#endif
-		bm_set_bit(bm->bmw, i);
-	}
+	bm_change_bits(bm, bitpos, n_bits, true);
 
 	return;
 }
@@ -1,5 +1,5 @@
 \ *****************************************************************************
-\ * Copyright (c) 2004, 2008 IBM Corporation
+\ * Copyright (c) 2004, 2013 IBM Corporation
 \ * All rights reserved.
 \ * This program and the accompanying materials
 \ * are made available under the terms of the BSD License
@@ -13,63 +13,197 @@
 #include <claim.fs>
 \ Memory "heap" (de-)allocation.
 
-\ Keep a linked list of free blocks per power-of-two size.
-\ Never coalesce entries when freed; split blocks when needed while allocating.
-
-\ 3f CONSTANT (max-heads#)
-heap-end heap-start - log2 1+ CONSTANT (max-heads#)
+\ The heap is managed in granules of /heap-granule bytes.  Requests are only
+\ rounded up to the granule size, not to the next power of two.
+\
+\ Free blocks are kept in doubly linked lists, one list per power-of-two size
+\ class (a block of size s is in list 2log(s)).  Every free block carries
+\ its size in its first and in its last cell (boundary tags):
+\   +0      size
+\   +cell   next free block in same size class
+\   +2cells previous free block in same size class (0 = list head)
+\   +size-cell  size
+\ Allocated blocks have no header at all (free-mem gets the length), so
+\ a bitmap marks the first and last granule of each free block.  This way
+\ free-mem can find out whether the neighbour blocks are free and coalesce
+\ with them in constant time.
+\
+\ Allocated blocks are aligned to the largest power of two not greater than
+\ their size, up to a page (4 KiB), since some callers (like dma-alloc)
+\ rely on page aligned memory for page sized requests.
+
+20 CONSTANT /heap-granule
+
+heap-end heap-start - 2log 1+ CONSTANT (max-heads#)
 
 CREATE heads (max-heads#) cells allot
 heads (max-heads#) cells erase
 
+\ Bitmap with one bit per heap granule
+heap-end heap-start - /heap-granule / 7 + 3 rshift CONSTANT /heap-bitmap
+CREATE heap-bitmap /heap-bitmap allot
+heap-bitmap /heap-bitmap erase
+
+\ Statistics
+0 VALUE heap-used
+0 VALUE heap-high-water
+
+: size>head  ( size -- headptr )  2log cells heads + ;
+
+: >heap-size  ( len -- size )  /heap-granule 1- + /heap-granule negate and ;
+
+: >heap-align  ( size -- align )  1 swap 2log lshift 1000 min ;
+
+: (heap-tag)  ( addr -- byte-addr mask )
+   heap-start - /heap-granule / dup 3 rshift heap-bitmap + swap 7 and 1 swap lshift
+;
+: heap-tag-set    ( addr -- )  (heap-tag) over c@ or swap c! ;
+: heap-tag-clear  ( addr -- )  (heap-tag) invert over c@ and swap c! ;
+: heap-tag?       ( addr -- free? )  (heap-tag) swap c@ and 0<> ;
+
+: >blk-next  ( blk -- addr )  cell+ ;
+: >blk-prev  ( blk -- addr )  2 cells + ;
+: blk-last   ( blk -- addr )  dup @ + /heap-granule - ;
+
+\ Turn the range blk..blk+size into a free block and link it to its list
+: blk-insert  ( blk size -- )
+   2dup swap !
+   2dup + cell- over swap !
+   over heap-tag-set  2dup + /heap-granule - heap-tag-set
+   size>head                                  ( blk head )
+   dup @ 2 pick >blk-next !
+   0 2 pick >blk-prev !
+   dup @ ?dup IF 2 pick swap >blk-prev ! THEN
+   !
+;
+
+\ Unlink a free block from its list
+: blk-remove  ( blk -- )
+   dup heap-tag-clear  dup blk-last heap-tag-clear
+   dup >blk-prev @ ?dup 0= IF dup @ size>head ELSE >blk-next THEN
+   over >blk-next @ swap !
+   dup >blk-next @ ?dup IF swap >blk-prev @ swap >blk-prev ! ELSE drop THEN
+;
+
+\ Temporaries of alloc-mem
+0 VALUE (alloc-size)
+0 VALUE (alloc-align)
+
+: (alloc-addr)  ( blk -- addr )
+   (alloc-align) 1- + (alloc-align) negate and
+;
+
+: (alloc-fits?)  ( blk -- flag )
+   dup (alloc-addr) (alloc-size) + swap dup @ + <=
+;
 
-: size>head  ( size -- headptr )  log2 3 max cells heads + ;
+\ Take the allocated range out of a free block, give back the rest
+: (alloc-carve)  ( blk -- addr )
+   dup blk-remove
+   dup @ over + >r                            ( blk  R: blk-end )
+   dup (alloc-addr) tuck over -               ( addr blk lead-size )
+   ?dup IF blk-insert ELSE drop THEN          ( addr  R: blk-end )
+   dup (alloc-size) + r> over -               ( addr tail tail-size )
+   ?dup IF blk-insert ELSE drop THEN
+;
 
+: (alloc-find)  ( -- blk|0 )
+   (max-heads#) (alloc-size) 2log DO
+      heads i cells + @
+      BEGIN dup WHILE
+         dup (alloc-fits?) IF UNLOOP EXIT THEN
+         >blk-next @
+      REPEAT
+      drop
+   LOOP
+   0
+;
 
 \ Allocate a memory block
 : alloc-mem  ( len -- a-addr )
    dup 0= IF EXIT THEN
-   1 over log2 3 max                   ( len 1 log_len )
-   dup (max-heads#) >= IF cr ." Out of internal memory." cr 3drop 0 EXIT THEN
-   lshift >r                           ( len  R: 1<<log_len )
-   size>head dup @ IF
-      dup @ dup >r @ swap ! r> r> drop EXIT
-   THEN                                ( headptr  R: 1<<log_len)
-   r@ 2* recurse dup                   ( headptr a-addr2 a-addr2  R: 1<<log_len)
-   dup 0= IF r> 2drop 2drop 0 EXIT THEN
-   r> + >r 0 over ! swap ! r>
+   >heap-size dup to (alloc-size) >heap-align to (alloc-align)
+   (alloc-size) 2log (max-heads#) >= IF cr ." Out of internal memory." cr 0 EXIT THEN
+   (alloc-find) ?dup 0= IF cr ." Out of internal memory." cr 0 EXIT THEN
+   (alloc-carve)
+   heap-used (alloc-size) + dup to heap-used
+   heap-high-water max to heap-high-water
 ;
 
 
 \ Free a memory block
 
 : free-mem  ( a-addr len -- )
-   dup 0= IF 2drop EXIT THEN size>head 2dup @ swap ! !
+   dup 0= IF 2drop EXIT THEN
+   >heap-size heap-used over - to heap-used      ( addr size )
+   \ Coalesce with the preceding free block
+   over heap-start > IF
+      over /heap-granule - heap-tag? IF
+         over cell- @ >r r@ + swap r> - swap      ( prev-blk size' )
+         over blk-remove
+      THEN
+   THEN
+   \ Coalesce with the following free block
+   2dup + dup heap-end < IF
+      dup heap-tag? IF
+         dup @ swap blk-remove +
+      ELSE
+         drop
+      THEN
+   ELSE
+      drop
+   THEN
+   blk-insert
 ;
 
 
 : #links  ( a -- n )
-   @ 0 BEGIN over WHILE 1+ swap @ swap REPEAT nip
+   @ 0 BEGIN over WHILE 1+ swap >blk-next @ swap REPEAT nip
 ;
 
+: #link-bytes  ( a -- n )
+   @ 0 BEGIN over WHILE over @ + swap >blk-next @ swap REPEAT nip
+;
+
+: heap-largest-free  ( -- n )
+   0 0 (max-heads#) 1- DO
+      heads i cells + @
+      BEGIN dup WHILE tuck @ max swap >blk-next @ REPEAT
+      drop dup IF LEAVE THEN
+   -1 +LOOP
+;
 
 : .free  ( -- )
    0 (max-heads#) 0 DO
-      heads i cells + #links dup IF
-         cr dup . ." * " 1 i lshift dup . ." = " * dup .
+      heads i cells + dup #links ?dup IF
+         cr dup . ." * " 1 i lshift . ." .. = " swap #link-bytes nip dup .
+      ELSE
+         drop 0
       THEN
       +
    LOOP
-   cr ." Total " .
+   cr ." Total " dup .
+   cr ." Largest free block " heap-largest-free dup .
+   cr ." In use " heap-used .
+   cr ." High-water mark " heap-high-water .
+   cr ." Fragmentation " swap ?dup IF 64 rot * swap / 64 swap - ELSE drop 0 THEN
+   .d ." %" cr
 ;
 
 
 \ Start with just one free block.
-heap-start heap-end heap-start - free-mem
+heap-start heap-end over - blk-insert
+
+\ Let the available map of claim.fs grow beyond its static node pool.
+: (avail-grow)  ( -- )
+   AVAIL-GROW-NODES /avail-node * alloc-mem ?dup IF
+      AVAIL-GROW-NODES avail-pool-add
+   THEN
+;
+' (avail-grow) to avail-grow
 
 
 \ : free-mem  ( a-addr len -- ) 2drop ;
 
 \ Uncomment the following line for debugging:
 \ #include <alloc-mem-debug.fs>
-
@@ -39,16 +39,23 @@ VARIABLE chosen-memory-ih 0 chosen-memory-ih !
 	THEN
 ;
 
-: update-available-property ( available-ptr -- )
-	dup >r available>size@
-	0= r@ available AVAILABLE-SIZE /available * + >= or IF
-		available r> available - encode-bytes (set-available-prop)
-	ELSE
-		r> /available + RECURSE
+0 VALUE (avail-prop)
+0 VALUE (avail-plen)
+
+: (encode-available) ( node -- )
+	dup avail>address @ encode-64 rot avail>size @ encode-64+
+	(avail-plen) IF
+		(avail-prop) (avail-plen) 2swap encode+
 	THEN
+	to (avail-plen) to (avail-prop)
 ;
 
-: update-available-property available update-available-property ;
+: update-available-property ( -- )
+	0 to (avail-prop) 0 to (avail-plen)
+	['] (encode-available) avail-walk
+	(avail-plen) 0= IF 0 0 encode-bytes to (avail-plen) to (avail-prop) THEN
+	(avail-prop) (avail-plen) (set-available-prop)
+;
 
 \ \\\\\\\\\\\\\\ Exported Interface:
 \ +
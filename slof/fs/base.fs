@@ -577,6 +577,8 @@ defer cursor-off ( -- )
 
 \ provide first level debug support
 #include "debug.fs"
+\ engine execution profile (see "make PROFILE=1")
+#include "profile.fs"
 \ provide 7.5.3.1 Dictionary search
 #include "dictionary.fs"
 \ block data access for IO devices - ought to be implemented in engine
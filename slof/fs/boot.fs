@@ -11,6 +11,9 @@
 \ ****************************************************************************/
 
 0 VALUE load-size
+\ Size of the loaded file.  It is bigger than load-size if the segments of
+\ an ELF file were streamed, then only the headers are at load-base.
+0 VALUE load-file-size
 0 VALUE go-entry
 VARIABLE state-valid false state-valid !
 CREATE go-args 2 cells allot go-args 2 cells erase
@@ -62,8 +65,22 @@ CREATE go-args 2 cells allot go-args 2 cells erase
 
 defer go ( -- )
 
+\ Export the boot phase timeline (see timeline.fs) to the client
+: (timeline-encode) ( n -- prop len )
+   timeline-entry dup timeline-tb encode-64
+   rot timeline-text encode-string encode+
+;
+
+: timeline>chosen ( -- )
+   timeline-count 0= IF EXIT THEN
+   timeline-first dup (timeline-encode)
+   rot 1+ timeline-count swap ?DO i (timeline-encode) encode+ LOOP
+   s" slof,boot-timeline" set-chosen
+;
+
 : go-32 ( -- )
    state-valid @ IF
+      timeline>chosen
       0 ciregs >r3 ! 0 ciregs >r4 !
       go-args 2@ go-entry start-elf client-data
       claim-list elf-release 0 to claim-list
@@ -72,6 +89,7 @@ defer go ( -- )
 ;
 : go-64 ( -- )
    state-valid @ IF
+      timeline>chosen
       0 ciregs >r3 ! 0 ciregs >r4 !
       go-args 2@ go-entry start-elf64 client-data
       claim-list elf-release 0 to claim-list
@@ -79,21 +97,19 @@ defer go ( -- )
    -6d boot-exception-handler ABORT
 ;
 
-: load-elf-init ( arg len file-addr -- success )
+: (load-elf-release) ( -- )
    false state-valid !                            \ Not valid anymore ...
    claim-list IF                                    \ Release claimed mem
       claim-list elf-release 0 to claim-list        \ from last load
    THEN
+;
 
-   true swap -1                       ( arg len true file-addr -1 )
-   elf-load-claim                     ( arg len true claim-list entry elftype )
-
-   ( arg len true claim-list entry elftype )
+: (load-elf-setup) ( arg len true claim-list entry elftype -- success )
    CASE
       1  OF ['] go-32 ENDOF           ( arg len true claim-list entry go )
       2  OF ['] go-64 ENDOF           ( arg len true claim-list entry go )
       dup OF ['] no-go to go
-         2drop 3drop false EXIT   ENDOF                   ( false )
+         2drop ?dup IF elf-release THEN 3drop false EXIT   ENDOF    ( false )
    ENDCASE
 
    to go to go-entry to claim-list
@@ -106,6 +122,75 @@ defer go ( -- )
    THEN
 ;
 
+: load-elf-init ( arg len file-addr -- success )
+   (load-elf-release)
+
+   true swap -1                       ( arg len true file-addr -1 )
+   s" elf-load" timeline-begin
+   elf-load-claim                     ( arg len true claim-list entry elftype )
+   s" elf-load" timeline-end
+
+   (load-elf-setup)
+;
+
+\ Streaming ELF load: only the headers are read to load-base, the segments
+\ go straight from the device to their load addresses.
+1000 CONSTANT /elf-stream-header
+
+: load-elf-stream-init ( arg len hdr-len ihandle -- success streamed? )
+   (load-elf-release)
+   get-load-base -rot
+   s" elf-load" timeline-begin
+   elf-stream-load-claim              ( arg len claim-list entry elftype )
+   s" elf-load" timeline-end
+   \ Not a streamable ELF file or a segment could not be read: release what
+   \ has been claimed and use the normal load path
+   dup 1 < IF 2drop ?dup IF elf-release THEN 2drop false false EXIT THEN
+   >r >r >r true r> r> r>             ( arg len true claim-list entry elftype )
+   (load-elf-setup) dup IF
+      0 ciregs 2dup >r3 ! >r4 !       \ Valid (ELF) image, see init-program
+   THEN
+   true
+;
+
+\ Only files on a filesystem can be streamed, they support size, seek and read
+: (elf-stream?) ( ihandle -- flag )
+   dup interposed? 0= IF drop false EXIT THEN
+   ihandle>phandle >r
+   s" size" r@ find-method 0= IF r> drop false EXIT THEN drop
+   s" seek" r@ find-method 0= IF r> drop false EXIT THEN drop
+   s" read" r> find-method dup IF nip THEN
+;
+
+\ Returns the length of the headers at load-base if the file has been
+\ streamed, or 0 if it has to be loaded with the normal load method.
+\ With a load-base-override (netload) the whole file is expected there.
+: (load-elf-stream) ( ihandle -- hdr-len | 0 )
+   load-base-override IF drop 0 EXIT THEN
+   dup (elf-stream?) 0= IF drop 0 EXIT THEN
+   >r s" size" r@ $call-method lxjoin           ( size R: ihandle )
+   dup 0= IF r> drop EXIT THEN
+   0 0 s" seek" r@ $call-method IF r> 2drop 0 EXIT THEN
+   \ The read methods of the filesystems abort at the end of the file
+   get-load-base over /elf-stream-header min
+   s" read" r@ ['] $call-method CATCH IF 2drop 3drop 0 ELSE 0 max THEN
+   ( size hdr-len R: ihandle )
+   dup IF
+      $bootargs 2 pick r@ ['] load-elf-stream-init CATCH IF
+         2drop 2drop 2drop 0
+         \ The segments that have been claimed before the failure
+         last-claim ?dup IF elf-release 0 to last-claim THEN
+      ELSE
+         nip IF swap to load-file-size ELSE 2drop 0 THEN
+      THEN
+   ELSE
+      nip
+   THEN
+   \ Not streamed: rewind for the normal load method
+   dup 0= IF 0 0 s" seek" r@ $call-method drop THEN
+   r> drop
+;
+
 : init-program ( -- )
    $bootargs get-load-base ['] load-elf-init CATCH ?dup IF
       boot-exception-handler
@@ -129,6 +214,7 @@ defer go ( -- )
       \ with watchdog timeout.
       4ec set-watchdog
    THEN
+   0 to load-file-size
    my-self >r current-node @ >r         \ Save my-self
    ." Trying to load: " $bootargs type ."  from: " 2dup type ."  ... "
    2dup open-dev dup IF
@@ -142,14 +228,22 @@ defer go ( -- )
       THEN
       encode-string s" bootpath" set-chosen
       $bootargs encode-string s" bootargs" set-chosen
-      get-load-base s" load" 3 pick ['] $call-method CATCH IF
-	-67 boot-exception-handler 3drop drop false
+      s" file-load" timeline-begin
+      dup (load-elf-stream) ?dup IF
+	 s" file-load" timeline-end
       ELSE
-	 dup 0> IF
-	    init-program
+	 get-load-base s" load" 3 pick ['] $call-method CATCH
+	 s" file-load" timeline-end
+	 IF
+	   -67 boot-exception-handler 3drop drop false
 	 ELSE
-	    false state-valid !
-	    drop 0                                     \ Could not load
+	    dup to load-file-size
+	    dup 0> IF
+	       init-program
+	    ELSE
+	       false state-valid !
+	       drop 0                                     \ Could not load
+	    THEN
 	 THEN
       THEN
       swap close-dev device-end dup to load-size
@@ -11,8 +11,9 @@
 \ ****************************************************************************/
 
 \ \\\\\\\\\\\\\\ Constants
-500 CONSTANT AVAILABLE-SIZE
 4000 CONSTANT MIN-RAM-RESERVE \ prevent from using first pages
+40 CONSTANT AVAIL-POOL-NODES  \ nodes available before alloc-mem works
+40 CONSTANT AVAIL-GROW-NODES  \ nodes added each time the pool runs dry
 
 : MIN-RAM-SIZE         \ Initially available memory size
    epapr-ima-size IF
@@ -25,225 +26,262 @@ MIN-RAM-SIZE CONSTANT MIN-RAM-SIZE
 
 \ \\\\\\\\\\\\\\ Structures
 \ +
-\ The available element size depends strictly on the address/size
-\ value formats and will be different for various device types
+\ The available ranges are kept in a treap (a binary search tree with
+\ random heap priorities) ordered by address.  Every node is also linked
+\ into a second treap ordered by size (and address for equal sizes), so
+\ claim can find the smallest range of a given size and alignment without
+\ looking at all ranges.
 \ +
 STRUCT
-	cell field available>address
-	cell field available>size
-CONSTANT /available
+	cell field avail>left
+	cell field avail>right
+	cell field avail>sleft
+	cell field avail>sright
+	cell field avail>address
+	cell field avail>size
+	cell field avail>prio
+CONSTANT /avail-node
 
 
 \ \\\\\\\\\\\\\\ Global Data
-CREATE available AVAILABLE-SIZE /available * allot available AVAILABLE-SIZE /available * erase
+0 VALUE avail-root
+0 VALUE avail-sroot	\ the same nodes ordered by size
+0 VALUE avail-free-nodes	\ linked via avail>left
+2545F4914F6CDD1D VALUE avail-seed
+CREATE avail-pool AVAIL-POOL-NODES /avail-node * allot
 VARIABLE mem-pre-released 0 mem-pre-released !
 
-\ \\\\\\\\\\\\\\ Structure/Implementation Dependent Methods
-: available>size@	available>size @ ;
-: available>address@	available>address @ ;
-: available>size!	available>size ! ;
-: available>address!	available>address ! ;
+\ Called when no node is left; alloc-mem.fs hooks in here to get more
+defer avail-grow ( -- )
+' noop to avail-grow
 
-: available! ( addr size available-ptr -- )
-	dup -rot available>size! available>address!
+\ \\\\\\\\\\\\\\ Node management
+: avail-node-free ( node -- )
+	avail-free-nodes over avail>left ! to avail-free-nodes
 ;
 
-: available@ ( available-ptr -- addr size )
-	dup available>address@ swap available>size@
+: avail-pool-add ( addr #nodes -- )
+	0 ?DO dup avail-node-free /avail-node + LOOP drop
 ;
 
+avail-pool AVAIL-POOL-NODES avail-pool-add
 
-\ \\\\\\\\\\\\\\ Implementation Independent Methods (Depend on Previous)
+\ xorshift pseudo random numbers for the node priorities
+: avail-random ( -- n )
+	avail-seed
+	dup d# 13 lshift xor dup d# 7 rshift xor dup d# 17 lshift xor
+	dup to avail-seed
+;
+
+: avail-end ( node -- end ) dup avail>address @ swap avail>size @ + ;
+
+\ Make sure that at least one free node is left, throw if not
+: avail-node-reserve ( -- )
+	avail-free-nodes 0= IF avail-grow THEN
+	avail-free-nodes 0= IF
+		cr ." claim error: out of memory for the available map" cr
+		123 throw
+	THEN
+;
+
+: avail-node-new ( addr size -- node )
+	avail-node-reserve
+	avail-free-nodes
+	dup avail>left @ to avail-free-nodes
+	>r r@ avail>size ! r@ avail>address !
+	0 r@ avail>left ! 0 r@ avail>right !
+	0 r@ avail>sleft ! 0 r@ avail>sright !
+	avail-random r@ avail>prio ! r>
+;
+
+
+\ \\\\\\\\\\\\\\ Treap primitives
 \ +
-\ Warning: They are not yet really independent from available formatting
+\ Split tree t into the nodes with address < key and the rest
 \ +
+: avail-split ( t key -- l r )
+	over 0= IF drop 0 EXIT THEN
+	over avail>address @ over u< IF
+		over avail>right @ swap RECURSE		( t l' r' )
+		>r over avail>right ! r>
+	ELSE
+		over avail>left @ swap RECURSE		( t l' r' )
+		2 pick avail>left ! swap
+	THEN
+;
 
 \ +
-\ Find position in the "available" where given range exists or can be inserted,
-\ return pointer and logical found/notfound value
-\ If error, return NULL pointer in addition to notfound code
+\ Join two trees, all addresses in l are below those in r
 \ +
-: (?available-segment<) ( start1 end1 start2 end2 -- true/false ) drop < nip ;
-
-: (?available-segment>) ( start1 end1 start2 end2 -- true/false ) -rot 2drop > ;
-
-\ start1 to end1 is the area that should be claimed
-\ start2 to end2 is the available segment
-\ return true if it can not be claimed, false if it can be claimed
-: (?available-segment-#) ( start1 end1 start2 end2 -- true/false )
-	2dup 5 roll -rot                ( e1 s2 e2 s1 s2 e2 )
-	between >r between r> and not
+: avail-merge ( l r -- t )
+	over 0= IF nip EXIT THEN
+	dup 0= IF drop EXIT THEN
+	over avail>prio @ over avail>prio @ u> IF
+		over avail>right @ swap RECURSE		( l t' )
+		over avail>right !
+	ELSE
+		swap over avail>left @ RECURSE		( r t' )
+		over avail>left !
+	THEN
 ;
 
-: (find-available) ( addr addr+size-1 a-ptr a-size -- a-ptr' found )
-	?dup 0= IF -rot 2drop false EXIT THEN	\ Not Found
-
-	2dup 2/ dup >r /available * +
-	( addr addr+size-1 a-ptr a-size a-ptr'  R: a-size' )
-	dup available>size@ 0= IF 2drop r> RECURSE EXIT THEN
+\ +
+\ The same for the size ordered treap, the key is (size, address)
+\ +
+0 VALUE (skey-size)
+0 VALUE (skey-addr)
 
-	( addr addr+size-1 a-ptr a-size a-ptr'  R: a-size' )
-	dup >r available@
-	( addr addr+size-1 a-ptr a-size addr' size'  R: a-size' a-ptr' )
-	over + 1- 2>r 2swap
-	( a-ptr a-size addr addr+size-1 )
-	( R: a-size' a-ptr' addr' addr'+size'-1 )
+: avail-skey ( node -- )
+	dup avail>size @ to (skey-size) avail>address @ to (skey-addr)
+;
 
-	2dup 2r@ (?available-segment>) IF
-		2swap 2r> 2drop r>
-		/available + -rot r> - 1- nip RECURSE EXIT	\ Look Right
-	THEN
-	2dup 2r@ (?available-segment<) IF
-		2swap 2r> 2drop r>
-		2drop r> RECURSE EXIT	\ Look Left
+\ Is the key of node below the current key?
+: avail-s< ( node -- flag )
+	dup avail>size @ (skey-size) 2dup = IF
+		2drop avail>address @ (skey-addr) u<
+	ELSE
+		u< nip
 	THEN
-	2dup 2r@ (?available-segment-#) IF	\ Conflict - segments overlap
-		2r> 2r> 3drop 3drop 2drop
-		1212 throw
+;
+
+: avail-ssplit ( t -- l r )
+	dup 0= IF 0 EXIT THEN
+	dup avail-s< IF
+		dup avail>sright @ RECURSE		( t l' r' )
+		>r over avail>sright ! r>
+	ELSE
+		dup avail>sleft @ RECURSE		( t l' r' )
+		2 pick avail>sleft ! swap
 	THEN
-	2r> 3drop 3drop r> r> drop	( a-ptr' -- )
-	dup available>size@ 0<>		( a-ptr' found -- )
 ;
 
-: (find-available) ( addr size -- seg-ptr found )
-	over + 1- available AVAILABLE-SIZE ['] (find-available) catch IF
-		2drop 2drop 0 false
+: avail-smerge ( l r -- t )
+	over 0= IF nip EXIT THEN
+	dup 0= IF drop EXIT THEN
+	over avail>prio @ over avail>prio @ u> IF
+		over avail>sright @ swap RECURSE	( l t' )
+		over avail>sright !
+	ELSE
+		swap over avail>sleft @ RECURSE	( r t' )
+		over avail>sleft !
 	THEN
 ;
 
+: avail-insert ( node -- )
+	dup avail-skey avail-sroot avail-ssplit		( node l r )
+	>r over avail-smerge r> avail-smerge to avail-sroot
+	avail-root over avail>address @ avail-split	( node l r )
+	>r swap avail-merge r> avail-merge to avail-root
+;
 
-: dump-available ( available-ptr -- )
-	cr
-	dup available - /available / AVAILABLE-SIZE swap - 0 ?DO
-		dup available@ ?dup 0= IF
-			2drop UNLOOP EXIT
-		THEN
-		swap . . cr
-		/available +
-	LOOP
-	dup
+: avail-remove ( node -- )
+	dup avail-skey avail-sroot avail-ssplit		( node l r )
+	(skey-addr) 1+ to (skey-addr) avail-ssplit	( node l m r' )
+	nip avail-smerge to avail-sroot
+	avail-root over avail>address @ avail-split	( node l r )
+	rot dup >r avail>address @ 1+ avail-split	( l m r' )
+	nip avail-merge to avail-root
+	r> avail-node-free
 ;
 
-: .available available dump-available ;
+: avail-add ( addr size -- ) avail-node-new avail-insert ;
 
 \ +
-\ release utils:
+\ The range with the highest address <= addr / lowest address >= addr
 \ +
+: avail-floor ( addr -- node|0 )
+	0 avail-root BEGIN dup WHILE			( addr best t )
+		dup avail>address @ 3 pick u<= IF
+			nip dup avail>right @
+		ELSE
+			avail>left @
+		THEN
+	REPEAT
+	drop nip
+;
+
+: avail-ceil ( addr -- node|0 )
+	0 avail-root BEGIN dup WHILE			( addr best t )
+		dup avail>address @ 3 pick u>= IF
+			nip dup avail>left @
+		ELSE
+			avail>right @
+		THEN
+	REPEAT
+	drop nip
+;
 
 \ +
-\ (drop-available) just blindly compresses space of available map
+\ In-order walk over all available ranges, xt is called with ( node -- )
 \ +
-: (drop-available) ( available-ptr -- )
-	dup available - /available /	\ current element index
-	AVAILABLE-SIZE swap -		\ # of remaining elements
+: (avail-walk) ( xt node -- )
+	?dup 0= IF drop EXIT THEN
+	2dup avail>left @ RECURSE
+	2dup swap execute
+	avail>right @ RECURSE
+;
 
-	( first nelements ) 1- 0 ?DO
-		dup /available + dup available@
+: avail-walk ( xt -- ) avail-root (avail-walk) ;
 
-		( current next next>address next>size ) ?dup 0= IF
-			2drop LEAVE \ NULL element - goto last copy
-		THEN
-		3 roll available!		( next )
-	LOOP
 
-	\ Last element : just zero it out
-	0 0 rot available!
-;
+\ \\\\\\\\\\\\\\ Implementation Independent Methods (Depend on Previous)
 
 \ +
-\ (stick-to-previous-available) merge the segment on stack
-\ with the previous one, if possible, and modified segment parameters if merged
-\ Return success code
+\ Find the available range that contains the given range completely
 \ +
-: (stick-to-previous-available) ( addr size available-ptr -- naddr nsize nptr success )
-	dup available = IF
-		false EXIT		\ This was the first available segment
-	THEN
-
-	dup /available - dup available@
-	+ 4 pick = IF
-		nip	\ Drop available-ptr since we are going to previous one
-		rot drop	\ Drop start addr, we take the previous one
-
-		dup available@ 3 roll + rot true
-		( prev-addr prev-size+size prev-ptr true )
+: (find-available) ( addr size -- avail-node found )
+	over avail-floor dup IF
+		dup avail-end 3 pick 3 pick + u>=
 	ELSE
-		drop false
-		( addr size available-ptr false )
+		false
 	THEN
+	>r >r 2drop r> r>
 ;
 
 \ +
-\ (insert-available) just blindly makes space for another element on given
-\ position
+\ Does the given range overlap with any available range?
 \ +
-\ insert-available should also check adjacent elements and merge if new
-\ region is contiguos w. others
-\ +
-: (insert-available) ( available-ptr -- available-ptr )
-	dup				\ current element
-	dup available - /available /	\ current element index
-	AVAILABLE-SIZE swap -		\ # of remaining elements
-
-	dup 0<= 3 pick available>size@ 0= or IF
-		\ End of "available" or came to an empty element - Exit
-		drop drop EXIT
+: (?available-overlap) ( addr size -- true/false )
+	over avail-floor ?dup IF
+		avail-end 2 pick u> IF 2drop true EXIT THEN
 	THEN
-
-	over available@ rot
-
-	( first	first/=current/ first>address first>size nelements ) 1- 0 ?DO
-		2>r
-		( first current R: current>address current>size )
-
-		/available + dup available@
-		( first current+1/=next/ next>address next>size )
-		( R: current>address current>size )
-
-		2r> 4 pick available! dup 0= IF
-			\ NULL element - last copy
-			rot /available + available!
-			UNLOOP EXIT
-		THEN
-	LOOP
-
-	( first next/=last/ last[0]>address last[0]>size ) ?dup 0<> IF
-		cr ." release error: available map overflow"
-		cr ." Dumping available property"
-		.available
-		cr ." No space for one before last entry:" cr swap . .
-		cr ." Dying ..." cr 123 throw
+	over avail-ceil ?dup IF
+		avail>address @ -rot + u<
+	ELSE
+		2drop false
 	THEN
-
-	2drop
 ;
 
-: insert-available ( addr size available-ptr -- addr size available-ptr )
-	dup available>address@ 0<> IF
-		\ Not empty :
-		dup available>address@ rot dup -rot -
-
-		( addr available-ptr size available>address@-size )
+: (.available-node) ( node -- )
+	dup avail>address @ . avail>size @ . cr
+;
 
-		3 pick = IF	\ if (available>address@ - size == addr)
-			\ Merge w. next segment - no insert needed
+: .available cr ['] (.available-node) avail-walk ;
 
-			over available>size@ + swap
-			( addr size+available>size@ available-ptr )
+\ +
+\ release utils:
+\ +
 
-			(stick-to-previous-available) IF
-				\ Merged w. prev & next one : discard extra seg
-				dup /available + (drop-available)
-			THEN
+\ +
+\ Add a range to the available map, merging it with adjacent ranges
+\ +
+: (release-available) ( addr size -- )
+	over avail-floor ?dup IF				\ Merge w. previous range
+		dup avail-end 3 pick = IF
+			>r nip r@ avail>size @ +
+			r@ avail>address @ swap r> avail-remove
 		ELSE
-			\ shift the rest of "available" to make space
-
-			swap (stick-to-previous-available)
-			not IF (insert-available) THEN
+			drop
+		THEN
+	THEN
+	2dup + avail-ceil ?dup IF				\ Merge w. next range
+		dup avail>address @ 3 pick 3 pick + = IF
+			dup avail>size @ swap avail-remove +
+		ELSE
+			drop
 		THEN
-	ELSE
-		(stick-to-previous-available) drop
 	THEN
+	avail-add
 ;
 
 defer release
@@ -251,34 +289,27 @@ defer release
 \ +
 \ claim utils:
 \ +
-: drop-available ( addr size available-ptr -- addr )
-	dup >r available@
-	( req_addr req_size segment_addr segment_size	R: available-ptr )
-
-	over 4 pick swap - ?dup 0<> IF
-		\ Segment starts before requested address : free the head space
-		dup 3 roll swap r> available! -
-
-		( req_addr req_size segment_size-segment_addr+req_addr )
-		over - ?dup 0= IF
-			\ That's it - remainder of segment is what we claim
-			drop
-		ELSE
-			\ Both head and tail of segment remain unclaimed :
-			\ need an extra available element
-			swap 2 pick + swap release
-		THEN
+\ The segment may have to be split into two ranges.  Its own node is freed
+\ by avail-remove, so reserve the second node first: running out of nodes
+\ after the removal would lose the whole segment.
+: drop-available ( addr size avail-node -- addr )
+	avail-node-reserve
+	dup avail>address @ over avail-end rot avail-remove
+	( req_addr req_size segment_addr segment_end )
+	>r
+	2 pick over - ?dup IF
+		\ Segment starts before requested address : keep the head
+		over swap avail-add
+	THEN
+	drop
+	2dup + r> over - ?dup IF
+		\ Keep the tail of the segment available
+		avail-add
 	ELSE
-		nip ( req_addr req_size segment_size )
-		over - ?dup 0= IF
-			\ Exact match : drop the whole available segment
-			drop r> (drop-available)
-		ELSE
-			\ We claimed the head, need to leave the tail available
-			-rot over + rot r> available!
-		THEN
+		drop
 	THEN
-	( base	R: -- )
+	drop
+	( base )
 ;
 
 : pwr2roundup ( value -- pwr2value )
@@ -290,42 +321,32 @@ defer release
 	dup +
 ;
 
-: (claim-best-fit) ( len align -- len base )
-	pwr2roundup 1- -1 -1
-	( len align-1 best-fit-residue/=-1/ best-fit-base/=-1/ )
-
-	available AVAILABLE-SIZE /available * + available DO
-		i		\ Must be saved now, before we use Return stack
-		-rot >r >r swap >r
-
-		( len i		R: best-fit-base best-fit-residue align-1 )
-
-		available@ ?dup 0= IF drop r> r> r> LEAVE THEN		\ EOL
-
-		2 pick - dup 0< IF
-			2drop			\ Can't Fit: Too Small
-		ELSE
-			dup 2 pick r@ and - 0< IF
-				2drop		\ Can't Fit When Aligned
-			ELSE
-				( len i>address i>size-len )
-				( R: best-fit-base best-fit-residue align-1 )
-				r> -rot dup r@ U< IF
-					\ Best Fit so far: drop the old one
-					2r> 2drop
-
-					( len align-1 nu-base nu-residue   R: )
-					\ Now align new base and push to R:
-					swap 2 pick + 2 pick invert and >r >r >r
-				ELSE
-					2drop >r
-				THEN
-			THEN
-		THEN
-		r> r> r>
-	/available +LOOP
+0 VALUE (fit-len)
+0 VALUE (fit-mask)
+0 VALUE (fit-base)
+
+\ In-order walk of the size treap that stops at the first fitting range
+: (avail-fit) ( node -- found? )
+	dup 0= IF EXIT THEN
+	dup avail>size @ (fit-len) u< IF avail>sright @ RECURSE EXIT THEN
+	dup avail>sleft @ RECURSE IF drop true EXIT THEN
+	dup avail>address @ (fit-mask) + (fit-mask) invert and	( node base )
+	dup (fit-len) + 2 pick avail-end u<= IF
+		to (fit-base) drop true EXIT
+	THEN
+	drop avail>sright @ RECURSE
+;
 
-	-rot 2drop	( len best-fit-base/or -1 if none found/ )
+\ +
+\ Smallest range that can hold len bytes at the given alignment (best fit,
+\ the lowest address wins on ties).  Ranges that are too small are never
+\ visited, only those that are big enough but fail the alignment are.
+\ +
+: (claim-fit) ( len align -- len base )
+	pwr2roundup 1- to (fit-mask)
+	dup to (fit-len)
+	-1 to (fit-base)
+	avail-sroot (avail-fit) drop (fit-base)
 ;
 
 : (adjust-release0) ( 0 size -- addr' size' )
@@ -348,7 +369,7 @@ defer release
 \ +
 : claim ( [ addr ] len align -- base )
 	?dup 0<> IF
-		(claim-best-fit) dup -1 = IF
+		(claim-fit) dup -1 = IF
 			2drop cr ." claim error : aligned allocation failed" cr
 			." available:" cr .available
 			321 throw EXIT
@@ -378,24 +399,15 @@ defer release
 : .release ( addr len -- )
 	over 0= mem-pre-released @ and IF (adjust-release0) THEN
 
-	2dup (find-available) IF
-		drop swap
+	2dup (find-available) nip IF
+		swap
 		cr ." release error: region " . ." , " . ." already released" cr
 	ELSE
-		?dup 0= IF
-			swap 
-			cr ." release error: Bad/conflicting region " . ." , " .
-			." or available list full " cr
+		2dup (?available-overlap) IF
+			swap
+			cr ." release error: Bad/conflicting region " . ." , " . cr
 		ELSE
-			( addr size available-ptr ) insert-available
-
-			\ NOTE: insert did not change the stack layout
-			\ 	but it may have changed any of the three values
-			\ 	in order to implement merge of free regions
-			\ 	We do not interpret these values any more
-			\ 	just blindly copy it in
-
-			( addr size available-ptr ) available!
+			(release-available)
 		THEN
 	THEN
 ;
@@ -95,6 +95,19 @@ VARIABLE  client-callback \ Address of client's callback function
 : string-to-buffer ( str len buf len -- len' )
   2dup erase rot min dup >r move r> ;
 
+\ The DHCP client of net-snk keeps its last lease in an NVRAM partition of
+\ its own, so that it can ask for the same address again on the next boot.
+: dhcp-cache-partition ( create? -- offset len true | false )
+  nvram-partition-type-dhcp get-nvram-partition 0= IF
+     rot drop true EXIT
+  THEN
+  0= IF false EXIT THEN
+  nvram-partition-type-dhcp s" dhcp" d# 64 new-nvram-partition IF
+     false EXIT
+  THEN
+  2dup erase-nvram-partition drop true
+;
+
 \ Now come the actual client interface words.
 
 ALSO client-voc DEFINITIONS
@@ -296,4 +309,21 @@ ALSO client-voc DEFINITIONS
 : set-callback ( newfunc -- oldfunc )
   client-callback @ swap client-callback ! ;
 
+\ Read and write the DHCP lease cache (see dhcp-cache-partition)
+: ibm,dhcp-cache-read ( buf len -- len' )
+  dhcp-cache? 0= IF 2drop 0 EXIT THEN
+  false dhcp-cache-partition 0= IF 2drop 0 EXIT THEN
+  rot min dup >r 0 ?DO                  ( buf offset )
+     dup i + nvram-c@ 2 pick i + c!
+  LOOP 2drop r>
+;
+
+: ibm,dhcp-cache-write ( buf len -- len' )
+  dhcp-cache? 0= IF 2drop 0 EXIT THEN
+  true dhcp-cache-partition 0= IF 2drop 0 EXIT THEN
+  rot min dup >r 0 ?DO                  ( buf offset )
+     over i + c@ over i + nvram-c!
+  LOOP 2drop nvram-sync r>
+;
+
 PREVIOUS DEFINITIONS
@@ -73,10 +73,11 @@ CREATE default-font-ctrblk /font allot default-font-ctrblk
 	dup font>min-char 20 swap !
 	font>#glyphs 7f swap !
 
+\ The font is used in place; it stays mapped as long as it is the default
 : display-default-font ( str len -- )
-   romfs-lookup dup 0= IF drop EXIT THEN
-   600 <> IF ." Only support 60x8x16 fonts ! " drop EXIT THEN
-   default-font-ctrblk font>addr !
+   romfs-map 0= IF EXIT THEN
+   dup 600 <> IF ." Only support 60x8x16 fonts ! " romfs-unmap EXIT THEN
+   drop default-font-ctrblk font>addr !
 ;
 
 s" default-font.bin" display-default-font
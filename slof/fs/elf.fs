@@ -58,6 +58,30 @@ false value elf-claim?
 ;
 
 
+\ Instance the segments are read from by elf-stream-load-claim
+0 VALUE elf-stream-ih
+
+: elf-read-segment ( dest offset len -- actual )
+   swap xlsplit s" seek" elf-stream-ih $call-method IF 2drop 0 EXIT THEN
+   s" read" elf-stream-ih $call-method
+;
+
+
+\ Like elf-load-claim, but only the ELF headers are in memory at hdr-addr.
+\ The segments are read from the given instance directly to their load
+\ addresses, so the file does not need to fit into the load-base area.
+: elf-stream-load-claim ( hdr-addr hdr-len ihandle -- claim-list entry imagetype )
+   to elf-stream-ih
+   true to elf-claim?
+   0 to last-claim
+   ['] elf-load-stream CATCH IF false to elf-claim? ABORT THEN
+   >r
+   last-claim swap
+   false to elf-claim?
+   r>
+;
+
+
 \ Release memory claimed before
 
 : elf-release ( claim-list -- )
@@ -226,6 +226,7 @@ VARIABLE nvoff \ offset in envvar partition
    envvars cell+
    BEGIN @ dup WHILE dup link> nvupdate-one REPEAT
    drop
+   nvram-sync
 ;
 
 : nvupdate ( -- )
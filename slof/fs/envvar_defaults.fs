@@ -38,6 +38,8 @@ false default-flag use-nvramrc?
 false default-flag direct-serial?
 true default-flag real-mode?
 true default-flag use-axon-ddr?
+true default-flag dhcp-cache?
+false default-flag tftp-multicast?
 default-load-base default-int load-base
 #ifdef BIOSEMU
 true default-flag use-biosemu?
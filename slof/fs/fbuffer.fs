@@ -54,14 +54,103 @@
 : fb8-background inverse? ;
 : fb8-foreground inverse? invert ;
 
+\ All drawing goes to a RAM copy of the frame buffer (the shadow), which is
+\ much cheaper to access than device memory.  The changed text cells are
+\ collected in a dirty rectangle and only that is copied to the device with
+\ rmove, which uses the widest accesses the alignment allows.
+\ The shadow comes from the alloc-mem heap, so it stays out of the way of
+\ loaded images and the OS.  A screen that would take more than half of the
+\ heap gets no shadow, and then all words draw to the device itself.
+
+0 VALUE fb8-shadow
+0 VALUE /fb8-shadow
+
+0 VALUE fb8-dirty-left
+0 VALUE fb8-dirty-top
+0 VALUE fb8-dirty-right
+0 VALUE fb8-dirty-bottom
+
 : fb8-lines2bytes ( #lines -- #bytes ) char-height * screen-width * screen-depth * ;
 : fb8-columns2bytes ( #columns -- #bytes ) char-width * screen-depth * ;
 : fb8-line2addr ( line# -- addr )
 	char-height * window-top + screen-width * screen-depth *
 	frame-buffer-adr + window-left screen-depth * +
 ;
+: fb8-buffer ( -- addr ) fb8-shadow ?dup 0= IF frame-buffer-adr THEN ;
+: fb8-line2buffer ( line# -- addr ) fb8-line2addr frame-buffer-adr - fb8-buffer + ;
+
+: fb8-move ( src dest len -- ) fb8-shadow IF move ELSE rmove THEN ;
+: fb8-erase-block ( addr len ) fb8-background fb8-shadow IF fill ELSE rfill THEN ;
+
+: fb8-init-shadow ( -- )
+	screen-height screen-width * screen-depth *
+	dup /fb8-shadow <> fb8-shadow 0= or IF
+		fb8-shadow ?dup IF /fb8-shadow free-mem 0 to fb8-shadow THEN
+		dup to /fb8-shadow
+		dup heap-end heap-start - 2/ <= IF alloc-mem ELSE drop 0 THEN
+		to fb8-shadow
+	ELSE drop THEN
+	fb8-shadow IF fb8-shadow /fb8-shadow fb8-erase-block THEN
+	0 to fb8-dirty-top 0 to fb8-dirty-bottom
+;
+
+\ Keep the shadow in sync with pixels that are written to the device directly
+: fb8-shadow-move ( src offset len -- )
+	fb8-shadow IF swap fb8-shadow + swap move ELSE 3drop THEN
+;
+: fb8-shadow-fill ( pattern offset len -- )
+	fb8-shadow IF swap fb8-shadow + swap rot fill ELSE 3drop THEN
+;
+
+\ Text cells from left/top up to (excluding) right/bottom have been changed
+: fb8-dirty ( left top right bottom -- )
+	fb8-dirty-top fb8-dirty-bottom < IF
+		fb8-dirty-bottom max to fb8-dirty-bottom
+		fb8-dirty-right max to fb8-dirty-right
+		fb8-dirty-top min to fb8-dirty-top
+		fb8-dirty-left min to fb8-dirty-left
+	ELSE
+		to fb8-dirty-bottom to fb8-dirty-right
+		to fb8-dirty-top to fb8-dirty-left
+	THEN
+;
 
-: fb8-erase-block ( addr len ) fb8-background rfill ;
+: fb8-dirty-char ( -- ) column# line# over 1+ over 1+ fb8-dirty ;
+: fb8-dirty-to-eol ( -- ) column# line# #columns over 1+ fb8-dirty ;
+: fb8-dirty-lines ( line# #lines -- ) 0 -rot over + #columns swap fb8-dirty ;
+
+\ Copy #rows rows of len bytes, starting at offset, from shadow to device
+: fb8-flush-rows ( offset len #rows -- )
+	fb8-shadow 0= IF 3drop EXIT THEN
+	0 ?DO
+		\ rmove may read the shadow cache-inhibited, so write it back first
+		over fb8-shadow + over 2dup flushcache
+		>r 2 pick frame-buffer-adr + r> rmove
+		swap screen-width screen-depth * + swap
+	LOOP 2drop
+;
+
+: fb8-flush ( -- )
+	fb8-dirty-top fb8-dirty-bottom < IF
+		fb8-dirty-left 0= fb8-dirty-right #columns = and IF
+			\ Complete text lines are one block if the margins are included
+			fb8-dirty-top char-height * window-top + screen-width * screen-depth *
+			fb8-dirty-bottom fb8-dirty-top - fb8-lines2bytes 1
+		ELSE
+			fb8-dirty-top fb8-line2addr frame-buffer-adr -
+			fb8-dirty-left fb8-columns2bytes +
+			fb8-dirty-right fb8-dirty-left - fb8-columns2bytes
+			fb8-dirty-bottom fb8-dirty-top - char-height *
+		THEN
+		fb8-flush-rows
+		0 to fb8-dirty-top 0 to fb8-dirty-bottom
+	THEN
+;
+
+: fb8-flush-all ( -- )
+	0 /fb8-shadow 1 fb8-flush-rows
+	0 to fb8-dirty-top 0 to fb8-dirty-bottom
+;
 
 
 0 VALUE .ab
@@ -73,7 +162,9 @@ CREATE bitmap-buffer 400 4 * allot
 
 : fb8-char2bitmap ( font-height font-addr -- bitmap-buffer )
 	bitmap-buffer >r
-	char-height rot 0> IF r> char-width 2dup fb8-erase-block + >r 1- THEN
+	char-height rot 0> IF
+		r> char-width screen-depth * 2dup fb8-background fill + >r 1-
+	THEN
 
 	r> -rot char-width to .ab
 	( fb-addr font-addr font-height )
@@ -87,6 +178,46 @@ CREATE bitmap-buffer 400 4 * allot
 	bitmap-buffer
 ;
 
+\ Expanding a glyph bit by bit is slow, so every glyph is only expanded
+\ once for each polarity and kept in a cache.  The cache is rebuilt when
+\ the font or the depth changes.
+
+0 VALUE fb8-glyphs
+0 VALUE /fb8-glyphs
+0 VALUE #fb8-glyphs
+CREATE fb8-glyph-key /font cell+ allot
+fb8-glyph-key /font cell+ erase
+
+: /fb8-glyph ( -- len ) char-width char-height * screen-depth * ;
+
+: fb8-glyph-key? ( -- valid? )
+	default-font-ctrblk fb8-glyph-key /font comp 0=
+	fb8-glyph-key /font + @ screen-depth = and
+;
+
+: fb8-glyph-reset ( -- )
+	fb8-glyphs ?dup IF /fb8-glyphs free-mem THEN
+	default-font-ctrblk font>#glyphs @ 2* to #fb8-glyphs
+	#fb8-glyphs /fb8-glyph 1+ * dup to /fb8-glyphs alloc-mem to fb8-glyphs
+	\ One "expanded" flag per glyph follows the bitmaps
+	fb8-glyphs IF fb8-glyphs #fb8-glyphs /fb8-glyph * + #fb8-glyphs erase THEN
+	default-font-ctrblk fb8-glyph-key /font move
+	screen-depth fb8-glyph-key /font + !
+;
+
+: fb8-char2glyph ( font-height char -- bitmap )
+	fb8-glyph-key? 0= IF fb8-glyph-reset THEN
+	fb8-glyphs 0= IF >font fb8-char2bitmap EXIT THEN
+	dup default-font-ctrblk font>min-char @ -
+	dup default-font-ctrblk font>#glyphs @ = IF drop 0 THEN
+	2* inverse? IF 1+ THEN
+	dup /fb8-glyph * fb8-glyphs + swap
+	fb8-glyphs #fb8-glyphs /fb8-glyph * + +
+	( font-height char glyph-addr flag-addr )
+	dup c@ IF drop nip nip EXIT THEN
+	1 swap c! >r >font fb8-char2bitmap r@ /fb8-glyph move r>
+;
+
 \ \\\\\\\\\\\\\\ Exported Interface:
 \ *
 \ * IEEE 1275: Frame buffer support routines
@@ -96,45 +227,53 @@ CREATE bitmap-buffer 400 4 * allot
 	2drop 2drop
 ;
 
+: fb8-invert-byte ( addr -- )
+	fb8-shadow IF dup c@ -1 xor swap c! ELSE dup rb@ -1 xor swap rb! THEN
+;
+
 : fb8-toggle-cursor ( -- )
-	line# fb8-line2addr column# fb8-columns2bytes +
+	line# fb8-line2buffer column# fb8-columns2bytes +
 	char-height 0 ?DO
-		char-width screen-depth * 0 ?DO dup dup rb@ -1 xor swap rb! 1+ LOOP
+		char-width screen-depth * 0 ?DO dup fb8-invert-byte 1+ LOOP
 		screen-width screen-depth * + char-width screen-depth * -
 	LOOP drop
+	fb8-dirty-char fb8-flush
 ;
 
 : fb8-draw-character ( char -- )
     >r default-font over + r@ -rot between IF
-	2swap 3drop r> >font fb8-char2bitmap ( bitmap-buf )
-	line# fb8-line2addr column# fb8-columns2bytes + ( bitmap-buf fb-addr )
+	2swap 3drop r> fb8-char2glyph ( glyph )
+	line# fb8-line2buffer column# fb8-columns2bytes + ( glyph addr )
 	char-height 0 ?DO
-		2dup char-width screen-depth * mrmove
+		2dup char-width screen-depth * fb8-shadow IF move ELSE mrmove THEN
 		screen-width screen-depth * + >r char-width screen-depth * + r>
 	LOOP 2drop
+	fb8-dirty-char
     ELSE 2drop r> 3drop THEN
 ;
 
 : fb8-insert-lines ( n -- )
-	fb8-lines2bytes >r line# fb8-line2addr dup dup r@ +
-	#lines line# - fb8-lines2bytes r@ - rmove
+	fb8-lines2bytes >r line# fb8-line2buffer dup dup r@ +
+	#lines line# - fb8-lines2bytes r@ - fb8-move
 	r> fb8-erase-block
+	line# #lines over - fb8-dirty-lines
 ;
 
 : fb8-delete-lines ( n -- )
-	fb8-lines2bytes >r line# fb8-line2addr dup dup r@ + swap
-	#lines fb8-lines2bytes r@ - dup >r rmove
+	fb8-lines2bytes >r line# fb8-line2buffer dup dup r@ + swap
+	#lines fb8-lines2bytes r@ - dup >r fb8-move
 	r> + r> fb8-erase-block
+	line# #lines over - fb8-dirty-lines
 ;
 
 : fb8-insert-characters ( n -- )
-	line# fb8-line2addr column# fb8-columns2bytes + >r
+	line# fb8-line2buffer column# fb8-columns2bytes + >r
 	#columns column# - 2dup >= IF
 		nip dup 0> IF fb8-columns2bytes r> ELSE r> 2drop EXIT THEN
 	ELSE
 		fb8-columns2bytes swap fb8-columns2bytes tuck -
 		over r@ tuck + rot char-height 0 ?DO
-			3dup rmove
+			3dup fb8-move
 			-rot screen-width screen-depth * tuck + -rot + swap rot
 		LOOP
 		3drop r>
@@ -143,16 +282,17 @@ CREATE bitmap-buffer 400 4 * allot
 		dup 2 pick fb8-erase-block screen-width screen-depth * +
 	LOOP
 	2drop
+	fb8-dirty-to-eol
 ;
 
 : fb8-delete-characters ( n -- )
-	line# fb8-line2addr column# fb8-columns2bytes + >r
+	line# fb8-line2buffer column# fb8-columns2bytes + >r
 	#columns column# - 2dup >= IF
 		nip dup 0> IF fb8-columns2bytes r> ELSE r> 2drop EXIT THEN
 	ELSE
 		fb8-columns2bytes swap fb8-columns2bytes tuck -
 		over r@ + 2dup + r> swap >r rot char-height 0 ?DO
-			3dup rmove
+			3dup fb8-move
 			-rot screen-width screen-depth * tuck + -rot + swap rot
 		LOOP
 		3drop r> over -
@@ -161,29 +301,37 @@ CREATE bitmap-buffer 400 4 * allot
 		dup 2 pick fb8-erase-block screen-width screen-depth * +
 	LOOP
 	2drop
+	fb8-dirty-to-eol
 ;
 
 : fb8-reset-screen ( -- ) ( Left as no-op by design ) ;
 
 : fb8-erase-screen ( -- )
-	frame-buffer-adr screen-height screen-width * screen-depth * fb8-erase-block
+	fb8-buffer screen-height screen-width * screen-depth * fb8-erase-block
+	fb8-flush-all
 ;
 
-: fb8-invert-screen ( -- )
-	frame-buffer-adr screen-height screen-width * screen-depth * 2dup /x / 0 ?DO
-		dup rx@ -1 xor over rx! xa1+
-	LOOP 3drop
+: fb8-invert-shadow ( -- )
+	fb8-shadow ?dup IF
+		/fb8-shadow bounds ?DO i x@ -1 xor i x! /x +LOOP
+	ELSE
+		frame-buffer-adr screen-height screen-width * screen-depth *
+		bounds ?DO i rx@ -1 xor i rx! /x +LOOP
+	THEN
 ;
 
+: fb8-invert-screen ( -- ) fb8-invert-shadow fb8-flush-all ;
+
 : fb8-blink-screen ( -- ) fb8-invert-screen fb8-invert-screen ;
 
-: fb8-install ( width height #columns #lines -- )
-	1 to screen-depth
+: (fb-install) ( width height #columns #lines depth -- )
+	to screen-depth
 	2swap  to screen-height  to screen-width
 	screen-#rows min to #lines
 	screen-#columns min to #columns
 	screen-height char-height #lines * - 2/ to window-top
 	screen-width char-width #columns * - 2/ to window-left
+	fb8-init-shadow
 	['] fb8-toggle-cursor to toggle-cursor
 	['] fb8-draw-character to draw-character
 	['] fb8-insert-lines to insert-lines
@@ -195,12 +343,15 @@ CREATE bitmap-buffer 400 4 * allot
 	['] fb8-invert-screen to invert-screen
 	['] fb8-reset-screen to reset-screen
 	['] fb8-draw-logo to draw-logo
+	['] fb8-flush to flush-screen
+;
+
+: fb8-install ( width height #columns #lines -- )
+	1 (fb-install)
 ;
 
 : fb-install  ( width height #columns #lines depth -- )
-	>r
-	fb8-install
-	r> to screen-depth
+	(fb-install)
 ;
 
 
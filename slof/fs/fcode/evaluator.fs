@@ -37,14 +37,31 @@ create token-table 2000 cells allot    \ 1000h = 4096d
 
 ( ---------------------------------------------------- )
 
+\ Evaluate an FCode image in place, e.g. one mapped with romfs-map
+: execute-fcode ( addr len -- )
+   reset-fcode-end
+   drop set-ip evaluate-fcode
+;
+
+\ Copy a device ROM image to RAM, retry if the copy is incomplete
+: copy-rom ( rom-addr len -- ram-addr | 0 )
+   dup alloc-mem dup 0= IF nip nip EXIT THEN     ( rom-addr len ram-addr )
+   5 0 DO
+      3dup swap rom-move IF nip nip UNLOOP EXIT THEN
+   LOOP
+   swap free-mem drop
+   ." Copying device ROM image failed" cr 0
+;
+
+\ Device ROMs can only be read cache-inhibited, so the image is copied first
 : execute-rom-fcode ( addr len | false -- )
    reset-fcode-end
    ?dup IF
       diagnostic-mode? IF ." , executing ..." cr THEN
-      dup >r r@ alloc-mem dup >r swap rmove
-      r@ set-ip evaluate-fcode
+      tuck copy-rom ?dup 0= IF drop EXIT THEN    ( len ram-addr )
+      swap 2dup execute-fcode
       diagnostic-mode? IF ." Done." cr THEN
-      r> r> free-mem
+      free-mem
    THEN
 ;
 
@@ -24,7 +24,7 @@
 
 debug-init-nvram
 
-: debug-add-env ( "name" "value" -- ) debug-nvram-partition 2rot 2rot internal-add-env drop ;
+: debug-add-env ( "name" "value" -- ) debug-nvram-partition 2rot 2rot internal-add-env drop nvram-sync ;
 : debug-set-env ( "name" "value" -- ) debug-nvram-partition 2rot 2rot internal-set-env drop ;
 : debug-get-env ( "name" -- "value" TRUE | FALSE) debug-nvram-partition 2swap internal-get-env ;
 
@@ -97,6 +97,7 @@ history-init-nvram
       swap IF his>prev @ ELSE drop 0 THEN
    REPEAT
    2drop drop
+   nvram-sync
 ;
 
 \ redefine "end of SLOF" words to safe history
@@ -44,10 +44,11 @@ CREATE load-list 2 cells allot load-list 2 cells erase
 ;
 
 : .(client-exec) ( arg len -- rc )
-   s" snk" romfs-lookup 0<> IF
+   s" snk" romfs-map IF
       \ Load SNK client 15 MiB after Paflof... FIXME: Hard-coded offset is ugly!
-      paflof-start f00000 +
-      elf-load-file-to-addr drop start-elf64 client-data
+      over paflof-start f00000 +
+      elf-load-file-to-addr drop >r romfs-unmap r>
+      start-elf64 client-data
    ELSE
       2drop false
    THEN
@@ -15,6 +15,7 @@
 \ storing binary tables in the past
 60 CONSTANT nvram-partition-type-sas
 61 CONSTANT nvram-partition-type-sms
+6d CONSTANT nvram-partition-type-dhcp
 6e CONSTANT nvram-partition-type-debug
 6f CONSTANT nvram-partition-type-history
 70 CONSTANT nvram-partition-type-common
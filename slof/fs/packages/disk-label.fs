@@ -606,7 +606,7 @@ AA26         CONSTANT GPT-PREP-PARTITION-4
 ;
 
 
-: open ( -- true|false )
+: (open) ( -- true|false )
    init-block
 
    parse-partition 0= IF
@@ -622,6 +622,12 @@ AA26         CONSTANT GPT-PREP-PARTITION-4
    dup 0= IF debug-disk-label? IF ." not found." cr THEN close THEN \ free memory again
 ;
 
+: open ( -- true|false )
+   s" disk-label" timeline-begin
+   (open)
+   s" disk-label" timeline-end
+;
+
 
 \ Boot & Load w/o arguments is assumed to be boot from boot partition
 
@@ -146,6 +146,7 @@ INSTANCE VARIABLE current-pos
   /string REPEAT 2drop r> ;
 : seek ( lo hi -- status )
   lxjoin dup file-len @ > IF drop true EXIT THEN current-pos ! false ;
+: size ( -- size.lo size.hi )  file-len @ xlsplit ;
 : load ( adr -- len )
   file-len @ read dup file-len @ <> ABORT" ext2-files: failed loading file" ;
 
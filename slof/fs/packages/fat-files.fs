@@ -177,6 +177,7 @@ INSTANCE VARIABLE pos-in-data
 : read ( adr len -- actual )
   dup >r BEGIN dup WHILE 2dup read dup 0= ABORT" fat-files: read failed"
   /string ( tuck - >r + r> ) REPEAT 2drop r> ;
+: size ( -- size.lo size.hi )  file-len @ xlsplit ;
 : load ( adr -- len )
   file-len @ read dup file-len @ <> ABORT" fat-files: failed loading file" ;
 
@@ -312,6 +312,13 @@ INSTANCE VARIABLE index
 ;
 
 
+\ public size method
+
+: size ( -- size.lo size.hi )
+   file-size @ xlsplit
+;
+
+
 \ public read method
 
  : read ( addr len -- actual )
@@ -37,7 +37,10 @@ INSTANCE VARIABLE ciregs-buffer
 
     \ Allocate 1720 bytes to store the BOOTP-REPLY packet
     6B8 alloc-mem dup >r (u.) $cat s"  " $cat
-    huge-tftp-load @ IF s"  1 " ELSE s"  0 " THEN $cat
+    \ TFTP mode: 1 = huge load, 2 = multicast transfer (RFC 2090)
+    huge-tftp-load @ IF 1 ELSE 0 THEN
+    tftp-multicast? IF 2 OR THEN
+    (u.) $cat s"  " $cat
     \ Add desired TFTP-Blocksize as additional argument
     s" 1432 " $cat
     \ Add OBP-TFTP Bootstring argument, e.g. "10.128.0.1,bootrom.bin,10.128.40.1"
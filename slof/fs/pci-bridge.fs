@@ -31,10 +31,10 @@ s" pci-config-bridge.fs" included
 \ Set up the Bridge with either default or special settings
 : setup ( -- )
         \ is there special handling for this device, given vendor and device id?
-        filename romfs-lookup ?dup
+        filename romfs-map
                 IF
                         \ give it a special treatment
-                        evaluate
+                        2dup evaluate romfs-unmap
                 ELSE
                         \ no special handling for this device, attempt autoconfiguration
                         my-space pci-class-name type 2a emit cr
@@ -98,22 +98,24 @@ s" my-puid" my-phandle parent $call-static CONSTANT my-puid
 
 \ Set up the device with either default or special settings
 : setup ( -- )
+        devicefile timeline-begin
         \ is there special handling for this device, given vendor and device id?
-        devicefile romfs-lookup ?dup
+        devicefile romfs-map
                 IF
                         \ give it a special treatment
-                        evaluate
+                        2dup evaluate romfs-unmap
                 ELSE
-                        classfile romfs-lookup ?dup
+                        classfile romfs-map
                         IF
                             \ give it a pci-class related treatment
-                            evaluate
+                            2dup evaluate romfs-unmap
                         ELSE
                             \ no special handling for this device, attempt autoconfiguration
                             my-space pci-class-name type 2a emit cr
                             my-space pci-device-generic-setup
                         THEN
                 THEN
+        devicefile timeline-end
 ;
 
 \ Disable Bus Master, Memory Space and I/O Space for this device
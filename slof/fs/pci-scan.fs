@@ -300,7 +300,9 @@ DEFER func-pci-bridge-range-props
 
 : (probe-pci-host-bridge) ( bus-max bus-min -- )
         0d emit ."  Adapters on " puid 10 0.r cr        \ print the puid we're looking at
+        s" pci-scan" timeline-begin
         ( bus-max bus-min ) pci-probe-all               \ and walk the bus
+        s" pci-scan" timeline-end
         pci-device-number 0= IF                         \ IF no devices found
                 15 spaces                               \ | indent the output
                 ." None" cr                             \ | tell the world our result
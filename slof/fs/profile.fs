@@ -0,0 +1,44 @@
+\ *****************************************************************************
+\ * Copyright (c) 2013 IBM Corporation
+\ * All rights reserved.
+\ * This program and the accompanying materials
+\ * are made available under the terms of the BSD License
+\ * which accompanies this distribution, and is available at
+\ * http://www.opensource.org/licenses/bsd-license.php
+\ *
+\ * Contributors:
+\ *     IBM Corporation - initial implementation
+\ ****************************************************************************/
+
+\ Execution profile of the Forth engine.
+\ The counters are only maintained if paflof has been built with
+\ "make PROFILE=1", otherwise the list is always empty.
+\ Ticks are timebase ticks spent in the word itself (not in its callees).
+
+0 CONSTANT profile-by-count
+1 CONSTANT profile-by-ticks
+
+: (.profile-entry) ( n -- )
+   profile-entry                        ( xt count ticks )
+   cr d# 16 u.r d# 12 u.r space space
+   xt>name type
+;
+
+: (.profile) ( n key -- )
+   profile-sort                         ( n #entries )
+   dup 0= IF
+      2drop cr ." No profile data (built without PROFILE=1?)" cr EXIT
+   THEN
+   min
+   cr ."            ticks       count  word"
+   0 ?DO i (.profile-entry) LOOP cr
+;
+
+\ Show the n most frequently executed words
+: .profile ( n -- )  profile-by-count (.profile) ;
+
+\ Show the n words that consumed most of the time
+: .profile-time ( n -- )  profile-by-ticks (.profile) ;
+
+\ Profile the execution of a single xt from a clean state
+: profile-xt ( xt -- )  profile-reset profile-on execute profile-off ;
@@ -11,15 +11,28 @@
 \ ****************************************************************************/
 
 
-10 CONSTANT quiesce-xt#
+10 VALUE quiesce-xt#
 
-\ The array with the quiesce execution tokens:
-CREATE quiesce-xts quiesce-xt# cells allot
-quiesce-xts quiesce-xt# cells erase
+\ The array with the quiesce execution tokens. It starts in the dictionary
+\ and is moved to the heap (with twice the size) whenever it is full.
+CREATE quiesce-static-xts quiesce-xt# cells allot
+quiesce-static-xts quiesce-xt# cells erase
+quiesce-static-xts VALUE quiesce-xts
 
 0 VALUE quiesce-done?
 
 
+: grow-quiesce-xts  ( -- )
+   quiesce-xt# 2* cells alloc-mem ?dup 0= IF EXIT THEN    ( new )
+   dup quiesce-xt# 2* cells erase
+   quiesce-xts over quiesce-xt# cells move                ( new )
+   quiesce-xts quiesce-static-xts <> IF
+      quiesce-xts quiesce-xt# cells free-mem
+   THEN
+   to quiesce-xts
+   quiesce-xt# 2* to quiesce-xt#
+;
+
 \ Add a token to the quiesce execution token array:
 : add-quiesce-xt  ( xt -- )
    quiesce-xt# 0 DO
@@ -35,8 +48,13 @@ quiesce-xts quiesce-xt# cells erase
          THEN                  ( xt )
       THEN
    LOOP
-   drop                        ( xt -- )
-   ." Warning: quiesce xt list is full." cr
+   quiesce-xt# grow-quiesce-xts          ( xt old-xt# )
+   dup quiesce-xt# = IF
+      2drop
+      ." Warning: quiesce xt list is full." cr
+      EXIT
+   THEN
+   quiesce-xts swap cells + !
 ;
 
 
@@ -26,11 +26,85 @@ romfs-lookup-cb /romfs-lookup-control-block erase
     r@ over 8 + erase
     r@ zplace r> ;
 
-: romfs-lookup ( fn-str fn-len -- data size | false )
+\ Files with flag 2 set are compressed by build_romfs: the data starts with
+\ the unpacked size, followed by an LZ4 block.  They are unpacked into the
+\ heap when they are looked up.  romfs-lookup keeps the copy for good
+\ (users = -1), romfs-map counts its users and romfs-unmap frees the copy
+\ again when the last one is gone.
+
+2 CONSTANT romfs-flag-compressed
+
+STRUCT
+	cell field romfs-unpacked>next
+	cell field romfs-unpacked>file
+	cell field romfs-unpacked>data
+	cell field romfs-unpacked>size
+	cell field romfs-unpacked>users
+CONSTANT /romfs-unpacked
+
+0 VALUE romfs-unpacked-list
+
+: romfs-unpacked-find ( file-header -- entry | 0 )
+    romfs-unpacked-list BEGIN dup WHILE
+       2dup romfs-unpacked>file @ = IF nip EXIT THEN
+       romfs-unpacked>next @
+    REPEAT nip ;
+
+: romfs-unpacked-find-data ( addr -- entry | 0 )
+    romfs-unpacked-list BEGIN dup WHILE
+       2dup romfs-unpacked>data @ = IF nip EXIT THEN
+       romfs-unpacked>next @
+    REPEAT nip ;
+
+: romfs-unpacked-unlink ( entry -- )
+    dup romfs-unpacked-list = IF
+       romfs-unpacked>next @ to romfs-unpacked-list EXIT
+    THEN
+    romfs-unpacked-list BEGIN 2dup romfs-unpacked>next @ <> WHILE
+       romfs-unpacked>next @
+    REPEAT
+    swap romfs-unpacked>next @ swap romfs-unpacked>next ! ;
+
+: romfs-unpacked>data+size ( entry -- data size )
+    dup romfs-unpacked>data @ swap romfs-unpacked>size @ ;
+
+: (romfs-unpack) ( data size -- udata usize | false )
+    over @ dup alloc-mem dup 0= IF 2drop 2drop false EXIT THEN
+    ( data size usize udata )
+    2swap cell- swap cell+ swap 2over swap lz4-decompress
+    ( usize udata len )
+    2 pick <> IF
+       swap free-mem ." Corrupt compressed file in romfs" cr false
+    ELSE swap THEN ;
+
+\ Find or create the unpacked copy of the file in romfs-lookup-cb
+: romfs-unpacked-get ( data size -- entry | 0 )
+    romfs-lookup-cb romfs>file-header @ romfs-unpacked-find ?dup IF
+       nip nip EXIT
+    THEN
+    (romfs-unpack) dup 0= IF EXIT THEN
+    /romfs-unpacked alloc-mem >r
+    r@ romfs-unpacked>size ! r@ romfs-unpacked>data !
+    0 r@ romfs-unpacked>users !
+    romfs-lookup-cb romfs>file-header @ r@ romfs-unpacked>file !
+    romfs-unpacked-list r@ romfs-unpacked>next !
+    r@ to romfs-unpacked-list r> ;
+
+: romfs-unpack ( data size -- udata usize | false )
+    romfs-unpacked-get dup 0= IF EXIT THEN
+    -1 over romfs-unpacked>users ! romfs-unpacked>data+size ;
+
+: (romfs-lookup) ( fn-str fn-len -- data size true | false )
     create-filename romfs-base
-    romfs-lookup-cb romfs-lookup-entry call-c
-    0= IF romfs-lookup-cb dup romfs>data @ swap romfs>data-size @ ELSE
-    false THEN ;
+    romfs-lookup-cb romfs-lookup-entry call-c IF false EXIT THEN
+    romfs-lookup-cb dup romfs>data @ swap romfs>data-size @ true ;
+
+: romfs-compressed? ( -- flag )
+    romfs-lookup-cb romfs>flags @ romfs-flag-compressed and 0<> ;
+
+: romfs-lookup ( fn-str fn-len -- data size | false )
+    (romfs-lookup) 0= IF false EXIT THEN
+    romfs-compressed? IF romfs-unpack THEN ;
 
 : ibm,romfs-lookup ( fn-str fn-len -- data-high data-low size | 0 0 false )
   romfs-lookup dup
@@ -40,24 +114,27 @@ romfs-lookup-cb /romfs-lookup-control-block erase
 \ FIXME For a short time ...
 : romfs-lookup-client ibm,romfs-lookup ;
 
-\ Fixme temp implementation
-
-STRUCT
-	cell field romfs>next-off
-	cell field romfs>size
-	cell field romfs>flags
-	cell field romfs>data-off
-	cell field romfs>name
-
-CONSTANT /romfs-cb
+\ Map a file read-only for a consumer that is done with it afterwards:
+\ stored files are used in place, compressed files are unpacked.  Each
+\ successful romfs-map has to be paired with a romfs-unmap.
+
+: romfs-map ( fn-str fn-len -- addr len true | false )
+    (romfs-lookup) 0= IF false EXIT THEN
+    romfs-compressed? 0= IF true EXIT THEN
+    romfs-unpacked-get dup 0= IF EXIT THEN
+    dup romfs-unpacked>users @ 0>= IF 1 over romfs-unpacked>users +! THEN
+    romfs-unpacked>data+size true ;
+
+: romfs-unmap ( addr len -- )
+    drop romfs-unpacked-find-data ?dup 0= IF EXIT THEN
+    dup romfs-unpacked>users @ 1 > IF -1 swap romfs-unpacked>users +! EXIT THEN
+    dup romfs-unpacked>users @ 0< IF drop EXIT THEN
+    dup romfs-unpacked-unlink
+    dup romfs-unpacked>data+size free-mem
+    /romfs-unpacked free-mem ;
 
 : romfs-map-file ( fn-str fn-len -- file-addr file-size )
-  romfs-base >r
-  BEGIN 2dup r@ romfs>name zcount string=ci not WHILE
-    ( fn-str fn-len ) ( R: rom-cb-file-addr )
-    r> romfs>next-off dup @ dup 0= IF 1 THROW THEN + >r REPEAT
-    ( fn-str fn-len ) ( R: rom-cb-file-addr )
-    2drop r@ romfs>data-off @ r@ + r> romfs>size @ ;
+  romfs-map 0= IF 1 THROW THEN ;
 
 \ returns address of romfs-header file
 : flash-header ( -- address | false )
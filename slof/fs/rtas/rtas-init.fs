@@ -14,18 +14,18 @@
 \ It looks at the rtas binary in the flash and reads the rtas-size from
 \ its header at offset 8.
 : (rtas-size)  ( -- rtas-size )
-   s" rtas" romfs-lookup dup 0=
+   s" rtas" romfs-map 0=
    ABORT" romfs-lookup for rtas failed"
-   drop 8 + @
+   over 8 + @ >r romfs-unmap r>
 ;
 
 (rtas-size) CONSTANT rtas-size
 
 : instantiate-rtas ( adr -- entry )
     dup rtas-size erase
-    s" rtas" romfs-lookup 0=
+    s" rtas" romfs-map 0=
     ABORT" romfs-lookup for rtas failed"
-    rtas-config swap start-rtas ;
+    2dup 2>r drop rtas-config swap start-rtas 2r> romfs-unmap ;
 
 here fff + fffffffffffff000 and here - allot
 here rtas-size allot CONSTANT rtas-start-addr
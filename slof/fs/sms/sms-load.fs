@@ -14,7 +14,7 @@ false VALUE (sms-loaded?)
 
 false value (sms-available?)
 
-s" sms.fs" romfs-lookup IF true to (sms-available?) drop THEN
+s" sms.fs" romfs-map IF true to (sms-available?) romfs-unmap THEN
 
 (sms-available?) [IF]
 
@@ -36,9 +36,11 @@ defer delete-characters	\ 2B inited by display driver
 defer insert-lines	\ 2B inited by display driver
 defer delete-lines	\ 2B inited by display driver
 defer draw-logo		\ 2B inited by display driver
+defer flush-screen	\ 2B inited by display driver
 
 : nop-toggle-cursor ( nop ) ;
 ' nop-toggle-cursor to toggle-cursor
+' noop to flush-screen
 
 \ \\\\\\\\\\\\\\ Implementation Independent Methods (Depend on Previous)
 \ *
@@ -209,4 +211,5 @@ twtracebuf VALUE twbp
 		THEN
 	LOOP
  	restore-cursor
+	flush-screen
 ;
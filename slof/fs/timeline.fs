@@ -0,0 +1,83 @@
+\ *****************************************************************************
+\ * Copyright (c) 2013 IBM Corporation
+\ * All rights reserved.
+\ * This program and the accompanying materials
+\ * are made available under the terms of the BSD License
+\ * which accompanies this distribution, and is available at
+\ * http://www.opensource.org/licenses/bsd-license.php
+\ *
+\ * Contributors:
+\ *     IBM Corporation - initial implementation
+\ ****************************************************************************/
+
+\ Boot phase timeline
+\
+\ Every phase of the boot (FDT unflatten, PCI scan, driver probes, USB scan,
+\ disk-label, file load, ELF load, ...) records a begin and an end event
+\ with the current timebase value in a ring buffer.  The newest
+\ TIMELINE-ENTRIES events are kept.  ".timeline" shows them, and they are
+\ exported to the OS as "slof,boot-timeline" property in /chosen right
+\ before the client is started (see timeline>chosen in boot.fs).  Every record in that property consists of
+\ a 64-bit timebase value followed by a zero terminated string that starts
+\ with "B " (begin) or "E " (end) and the name of the phase.  The timebase
+\ frequency is found in the "timebase-frequency" property of the CPU nodes.
+
+d# 128 CONSTANT timeline-entries
+d# 32 CONSTANT /timeline-text
+
+\ Layout of one ring buffer entry:
+\   cell  timebase value
+\   byte  length of the event text
+\   bytes event text, i.e. "B " or "E " followed by the phase name
+cell 1+ /timeline-text + aligned CONSTANT /timeline-entry
+
+CREATE timeline-buf timeline-entries /timeline-entry * allot
+0 VALUE timeline-count
+
+: timeline-entry ( n -- addr )
+   timeline-entries mod /timeline-entry * timeline-buf +
+;
+
+: timeline-tb ( entry -- tb )  @ ;
+: timeline-text ( entry -- str len )  cell+ dup char+ swap c@ ;
+
+: (timeline-event) ( str len type -- )
+   timeline-count timeline-entry >r        ( str len type  R: entry )
+   tb@ r@ !
+   r@ cell+ char+ c!  bl r@ cell+ 2+ c!
+   /timeline-text 2- min dup 2+ r@ cell+ c!
+   r> cell+ 3 + swap move
+   timeline-count 1+ to timeline-count
+;
+
+\ Mark the begin and the end of a boot phase
+: timeline-begin ( str len -- )  [char] B (timeline-event) ;
+: timeline-end ( str len -- )  [char] E (timeline-event) ;
+
+: timeline-first ( -- n )  timeline-count timeline-entries - 0 max ;
+
+: timeline-reset ( -- )  0 to timeline-count ;
+
+\ The timebase may count from host boot (KVM), so multiply with a double
+\ cell intermediate result to avoid an overflow
+: tb>us ( tb -- us )  d# 1000000 um* tb-frequency um/mod nip ;
+
+\ Print the recorded events, nested phases are indented
+: .timeline ( -- )
+   timeline-count 0= IF ." Timeline is empty" cr EXIT THEN
+   base @ >r decimal
+   cr ."        time[us]   delta[us]  event" cr
+   0 timeline-first dup timeline-entry timeline-tb      ( depth first tb )
+   timeline-count rot ?DO                               ( depth prev-tb )
+      i timeline-entry >r
+      r@ timeline-tb dup tb>us d# 15 u.r
+      dup rot - tb>us d# 12 u.r space space             ( depth tb )
+      swap r@ timeline-text drop c@ [char] E = IF 1- 0 max THEN
+      dup 2* spaces
+      r@ timeline-text drop c@ [char] B = IF 1+ THEN
+      r> timeline-text type cr
+      swap
+   LOOP
+   2drop
+   r> base !
+;
@@ -43,6 +43,7 @@
 
 : usb-scan ( -- )
     ." Scanning USB " cr
+    s" usb-scan" timeline-begin
     ohci-alias-num 1 >= IF
 	USB-OHCI-REGISTER
     THEN
@@ -72,4 +73,5 @@
     LOOP
 
     0 set-node     \ FIXME Setting it back
+    s" usb-scan" timeline-end
 ;
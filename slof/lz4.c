@@ -0,0 +1,95 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+/*
+ * Decoder for LZ4 blocks, as written by build_romfs for compressed
+ * romfs files (see romfs/tools/compress.c).
+ */
+#include <string.h>
+#include <lz4.h>
+
+/* a length field of 15 is continued by bytes up to the first one != 255 */
+static int lz4_length(const unsigned char **ip, const unsigned char *iend,
+		      unsigned long *len)
+{
+	unsigned char b;
+
+	if (*len != 15)
+		return 0;
+	do {
+		if (*ip >= iend)
+			return -1;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return 0;
+}
+
+/**
+ * Unpack the LZ4 block src (srclen bytes) to dest, which has room for
+ * destlen bytes. Returns the number of bytes written to dest or -1 if the
+ * block is corrupt or does not fit into dest.
+ */
+long lz4_decompress(const void *src, unsigned long srclen, void *dest,
+		    unsigned long destlen)
+{
+	const unsigned char *ip = src, *iend = ip + srclen;
+	unsigned char *ostart = dest, *op = dest, *oend = op + destlen;
+	const unsigned char *ref;
+	unsigned long len, offset;
+	unsigned char token;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		/* literals */
+		len = token >> 4;
+		if (lz4_length(&ip, iend, &len))
+			return -1;
+		if (len > (unsigned long)(iend - ip) ||
+		    len > (unsigned long)(oend - op))
+			return -1;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* the last sequence has no match part */
+		if (ip == iend)
+			break;
+
+		/* match */
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (unsigned long)(op - ostart))
+			return -1;
+		ref = op - offset;
+
+		len = token & 15;
+		if (lz4_length(&ip, iend, &len))
+			return -1;
+		len += 4;
+		if (len > (unsigned long)(oend - op))
+			return -1;
+
+		if (offset >= len) {
+			memcpy(op, ref, len);
+			op += len;
+		} else {
+			/* overlapping copy repeats the last offset bytes */
+			while (len--)
+				*op++ = *ref++;
+		}
+	}
+
+	return op - ostart;
+}
@@ -24,6 +24,8 @@
 #include <ctype.h>
 #include <cache.h>
 #include <allocator.h>
+#include <lz4.h>
+#include <profile.h>
 
 #include ISTR(TARG,h)
 
@@ -0,0 +1,162 @@
+/******************************************************************************
+ * Copyright (c) 2013 IBM Corporation
+ * All rights reserved.
+ * This program and the accompanying materials
+ * are made available under the terms of the BSD License
+ * which accompanies this distribution, and is available at
+ * http://www.opensource.org/licenses/bsd-license.php
+ *
+ * Contributors:
+ *     IBM Corporation - initial implementation
+ *****************************************************************************/
+/*
+ * Execution profile of the Forth engine.
+ *
+ * When paflof is built with ENGINE_PROFILE (make PROFILE=1), every
+ * dispatch of the inner interpreter calls SLOF_profile_hit() with the
+ * execution token that is about to run.  The xt is counted in a small
+ * open addressing hash table, and the timebase ticks that passed since
+ * the previous dispatch are charged to the previously running xt.  So
+ * "ticks" is the time spent in the word itself, not including the
+ * words it calls.
+ */
+
+#include <string.h>
+#include <profile.h>
+
+#ifdef ENGINE_PROFILE
+#define PROFILE_SLOTS	0x2000	/* must be a power of two */
+/* Start counting right away, so that the boot itself gets profiled */
+int profile_enabled = 1;
+#else
+#define PROFILE_SLOTS	0
+int profile_enabled;
+#endif
+
+#if PROFILE_SLOTS
+
+static struct profile_entry profile_table[PROFILE_SLOTS];
+static struct profile_entry *profile_sorted[PROFILE_SLOTS];
+static long profile_nsorted;
+static struct profile_entry *profile_current;
+static unsigned long profile_last_tb;
+
+static inline unsigned long profile_tb(void)
+{
+	unsigned long tb;
+
+	asm volatile("mftb %0" : "=r"(tb));
+	return tb;
+}
+
+static inline unsigned long profile_hash(void *xt)
+{
+	unsigned long h = (unsigned long)xt >> 3;
+
+	return (h ^ (h >> 13)) & (PROFILE_SLOTS - 1);
+}
+
+void SLOF_profile_hit(void *xt)
+{
+	unsigned long tb = profile_tb();
+	unsigned long i, n;
+	struct profile_entry *e = NULL;
+
+	if (profile_current)
+		profile_current->ticks += tb - profile_last_tb;
+
+	i = profile_hash(xt);
+	for (n = 0; n < PROFILE_SLOTS; n++) {
+		e = &profile_table[i];
+		if (e->xt == xt || !e->xt)
+			break;
+		i = (i + 1) & (PROFILE_SLOTS - 1);
+	}
+	if (n == PROFILE_SLOTS) {
+		/* Table is full, don't account this xt */
+		profile_current = NULL;
+		return;
+	}
+
+	e->xt = xt;
+	e->count++;
+	profile_current = e;
+	/* Don't charge our own bookkeeping to the next word */
+	profile_last_tb = profile_tb();
+}
+
+void SLOF_profile_reset(void)
+{
+	memset(profile_table, 0, sizeof(profile_table));
+	profile_current = NULL;
+	profile_nsorted = 0;
+}
+
+static unsigned long profile_key(struct profile_entry *e, int key)
+{
+	return key == PROFILE_BY_TICKS ? e->ticks : e->count;
+}
+
+/**
+ * Sort the used entries of the profile table in descending order.
+ * The table itself is left untouched so that counting can continue
+ * afterwards.
+ *
+ * @param key  PROFILE_BY_COUNT or PROFILE_BY_TICKS
+ * @return     number of valid entries for SLOF_profile_entry()
+ */
+long SLOF_profile_sort(int key)
+{
+	long i, j, n = 0;
+	struct profile_entry *e;
+
+	for (i = 0; i < PROFILE_SLOTS; i++)
+		if (profile_table[i].xt)
+			profile_sorted[n++] = &profile_table[i];
+
+	/* Shell sort - this is only called from the prompt */
+	for (j = n / 2; j > 0; j /= 2) {
+		for (i = j; i < n; i++) {
+			long k = i;
+			e = profile_sorted[i];
+			while (k >= j && profile_key(profile_sorted[k - j], key)
+			       < profile_key(e, key)) {
+				profile_sorted[k] = profile_sorted[k - j];
+				k -= j;
+			}
+			profile_sorted[k] = e;
+		}
+	}
+
+	profile_nsorted = n;
+	return n;
+}
+
+struct profile_entry *SLOF_profile_entry(long n)
+{
+	if (n < 0 || n >= profile_nsorted)
+		return NULL;
+	return profile_sorted[n];
+}
+
+#else /* !PROFILE_SLOTS */
+
+void SLOF_profile_hit(void *xt __attribute__((unused)))
+{
+}
+
+void SLOF_profile_reset(void)
+{
+}
+
+long SLOF_profile_sort(int key __attribute__((unused)))
+{
+	return 0;
+}
+
+struct profile_entry *SLOF_profile_entry(long n __attribute__((unused)))
+{
+	return NULL;
+}
+
+#endif /* PROFILE_SLOTS */